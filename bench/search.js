@@ -0,0 +1,72 @@
+/**
+ * Benchmark timestamp lookups with the search tree against a plain binary search.
+ *
+ * Writes a temporary nbs file with one very large type (like a day of high rate IMU data), then times `getPackets()`
+ * and `nextTimestamp()` at random timestamps with `searchTreeThreshold: 0` and `searchTreeThreshold: Infinity`.
+ *
+ * Usage: node bench/search.js [packet count]
+ */
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const { NbsDecoder, NbsEncoder } = require('..');
+
+const count = Number(process.argv[2] || 5e6);
+const queries = 200000;
+const type = Buffer.from('8ce1582fa0eadc84', 'hex');
+
+function time(name, fn) {
+  const start = process.hrtime.bigint();
+  fn();
+  const elapsed = Number(process.hrtime.bigint() - start);
+  console.log(`  ${name.padEnd(16)} ${(elapsed / queries).toFixed(0).padStart(6)} ns/query`);
+}
+
+const dir = fs.mkdtempSync(`${os.tmpdir()}${path.sep}`);
+try {
+  const file = path.join(dir, 'bench.nbs');
+
+  console.log(`writing ${count} packets...`);
+  const encoder = new NbsEncoder(file);
+  const payload = Buffer.alloc(8);
+  for (let i = 0; i < count; i++) {
+    // 1ms apart, so a million packets cover about 17 minutes
+    encoder.write({
+      timestamp: { seconds: Math.floor(i / 1000), nanos: (i % 1000) * 1e6 },
+      type,
+      payload,
+    });
+  }
+  encoder.close();
+
+  // Use the same random timestamps for both decoders
+  const timestamps = [];
+  for (let i = 0; i < queries; i++) {
+    timestamps.push(BigInt(Math.floor(Math.random() * count)) * 1000000n);
+  }
+
+  for (const [name, searchTreeThreshold] of [
+    ['binary search', Infinity],
+    ['search tree', 0],
+  ]) {
+    const decoder = new NbsDecoder([file], { searchTreeThreshold });
+    console.log(name);
+
+    time('getPackets', () => {
+      for (const timestamp of timestamps) {
+        decoder.getPackets(timestamp, [{ type, subtype: 0 }]);
+      }
+    });
+
+    time('nextTimestamp', () => {
+      for (const timestamp of timestamps) {
+        decoder.nextTimestamp(timestamp, { type, subtype: 0 }, 1);
+      }
+    });
+
+    decoder.close();
+  }
+} finally {
+  fs.rmSync(dir, { recursive: true });
+}
@@ -4,10 +4,13 @@
             "target_name": "nbsdecoder",
             "sources": [
                 "src/binding.cpp",
+                "src/AsyncTask.cpp",
                 "src/Decoder.cpp",
                 "src/Encoder.cpp",
+                "src/Follower.cpp",
                 "src/Hash.cpp",
                 "src/Packet.cpp",
+                "src/Scanner.cpp",
                 "src/Timestamp.cpp",
                 "src/third-party/xxhash/xxhash.c",
             ],
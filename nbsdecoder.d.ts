@@ -24,7 +24,10 @@ export interface NbsPacket {
   /** The packet subtype */
   subtype: number;
 
-  /** The packet data, undefined for empty packets */
+  /**
+   * The packet data, undefined for empty packets. With the `zeroCopy` option this points into a read only map of
+   * the nbs file and must not be written to.
+   */
   payload?: Buffer;
 }
 
@@ -67,6 +70,346 @@ export interface TypeIndex {
   timestamps: NbsTimestamp[];
 }
 
+/** Passed to the `follow()` callback when packets are appended to the nbs files */
+export interface NbsFollowEvent {
+  /** The number of new packets */
+  packets: number;
+
+  /** The timestamp of the earliest new packet */
+  start: NbsTimestamp;
+
+  /** The timestamp of the latest new packet */
+  end: NbsTimestamp;
+}
+
+/**
+ * Options for following nbs files
+ */
+export interface NbsFollowOptions {
+  /** How often to check the nbs files for new packets, in milliseconds. Defaults to 100. */
+  interval?: number;
+}
+
+/**
+ * Options for creating an NbsDecoder
+ */
+export interface NbsDecoderOptions {
+  /**
+   * Path of a file to cache the built index in. When the cache is up to date with the nbs files (and their index
+   * files) it is memory mapped and used directly, skipping the index build. A stale cache is rebuilt automatically.
+   * If `true`, the cache is kept next to the first nbs file as `<path>.idxcache`.
+   */
+  indexCache?: string | boolean;
+
+  /**
+   * Nbs files without an index file are scanned for their packets to build the index. Scanned packets all have a
+   * subtype of 0, since subtypes are only stored in index files. If true, write the scanned index out as the missing
+   * index file so the next open doesn't need to scan. Defaults to false.
+   */
+  writeScannedIndex?: boolean;
+
+  /**
+   * Types with at least this many packets get a cache friendly search tree over their timestamps, which speeds up
+   * `getPackets()` and `nextTimestamp()` for very large types at the cost of some extra memory. Set to 0 to build one
+   * for every type, or `Infinity` to always use a plain binary search. Defaults to 65536.
+   */
+  searchTreeThreshold?: number;
+
+  /**
+   * Types with many packets whose timestamps are spaced uniformly enough, such as sensors sampled at a fixed rate,
+   * are searched by predicting the position of a timestamp and then searching only near the prediction. These types
+   * don't get a search tree. Defaults to true.
+   */
+  interpolationSearch?: boolean;
+
+  /**
+   * If true, count the timestamp searches of each type and the timestamps they probe, for `getSearchStats()`. Off by
+   * default, since counting adds shared writes to every search. Defaults to false.
+   */
+  searchStats?: boolean;
+
+  /**
+   * If true, packet payloads are Buffers that point straight into the memory mapped nbs files rather than copies,
+   * which saves copying large payloads such as images. Each file stays mapped until the decoder is closed and every
+   * payload from it has been garbage collected. Runtimes that don't allow Buffers of external memory get copies
+   * instead. Defaults to false.
+   *
+   * **Warning:** the files are mapped read only, so writing to one of these payloads (such as `payload[0] = 1`,
+   * `payload.fill(0)` or `payload.write(...)`) crashes the whole process with a segmentation fault instead of
+   * throwing. Copy a payload with `Buffer.from(payload)` before changing it.
+   */
+  zeroCopy?: boolean;
+
+  /**
+   * Keep up to this many bytes of the packets that were read most recently, so reading them again (such as when
+   * scrubbing back and forth) returns the same packet objects without reading them again. Defaults to 0, which caches
+   * nothing.
+   *
+   * Only the synchronous reads (`getPackets()`, `getPacketsAt()`, `getPacketsInRange()`, `getPacketByIndex()` and the
+   * cursors) use the cache. The async reads and `stream()` always build new packets, since they are built after the
+   * work on the thread pool, and `getPacketColumns()` copies the payloads into its own Buffer.
+   *
+   * Cached packets are not copied or frozen: every read that hits the cache returns the same mutable object, so
+   * changing a packet's `timestamp` or the bytes of its `payload` changes what later reads return. Copy a packet
+   * before changing it.
+   */
+  packetCache?: number;
+
+  /**
+   * How the nbs files will be read, as a hint to the OS: `'sequential'` for playing through them in order, which reads
+   * further ahead, or `'random'` for jumping around them, which reads only what is asked for. Ignored on Windows.
+   * Defaults to `'normal'`.
+   */
+  accessPattern?: 'normal' | 'sequential' | 'random';
+
+  /**
+   * Files of at most this many bytes are read into memory when they are opened, so reading packets from them never
+   * waits for the disk. Use `Infinity` to read every file in. Defaults to 0.
+   */
+  populate?: number;
+
+  /**
+   * If true, ask for the memory maps to use transparent huge pages. Only some file systems on Linux support this for
+   * files, and elsewhere it does nothing. Defaults to false.
+   */
+  hugePages?: boolean;
+
+  /**
+   * If true, the index of each type is packed into blocks of delta encoded items, which takes around a fifth of the
+   * memory of the normal index. Finding a packet has to decode part of a block, so lookups are a little slower. Has no
+   * effect when `indexCache` is set, since the cache is memory mapped rather than held in memory. Defaults to false.
+   */
+  compactIndex?: boolean;
+
+  /**
+   * If true, opening the decoder only finds the types in the nbs files and how many packets each has. The index of
+   * each type is loaded the first time it is used, so startup time and memory use follow the types that are actually
+   * looked at. Loaded types can be released again with `evict()`. Has no effect when `indexCache` is set, since the
+   * cache is already only read from disk as it is used. Defaults to false.
+   */
+  lazy?: boolean;
+}
+
+/**
+ * Options for reading the packets in a range of timestamps
+ */
+export interface NbsRangeOptions {
+  /** The most packets to return. Defaults to no limit. */
+  limit?: number;
+
+  /** Skip this many packets at the start of the range, for reading a large range a page at a time. Defaults to 0. */
+  offset?: number;
+}
+
+/**
+ * The parts of an AbortSignal used to abort the async methods of a decoder
+ */
+export interface NbsAbortSignal {
+  readonly aborted: boolean;
+  addEventListener(type: 'abort', listener: () => void): void;
+  removeEventListener(type: 'abort', listener: () => void): void;
+}
+
+/**
+ * Options for the async methods of a decoder
+ */
+export interface NbsAsyncOptions {
+  /**
+   * A signal to abort the call with. Aborting rejects the returned promise with an error named `AbortError`, and
+   * stops the work on the thread pool early where it can.
+   */
+  signal?: NbsAbortSignal;
+}
+
+/**
+ * Options for opening a decoder with `NbsDecoder.open()`
+ */
+export interface NbsOpenOptions extends NbsDecoderOptions, NbsAsyncOptions {}
+
+/**
+ * Options for reading the packets in a range of timestamps with `getPacketsInRangeAsync()`
+ */
+export interface NbsRangeAsyncOptions extends NbsRangeOptions, NbsAsyncOptions {}
+
+/**
+ * Options for streaming packets with `stream()`
+ */
+export interface NbsStreamOptions extends NbsAsyncOptions {
+  /** The types to stream. Defaults to every type. */
+  types?: NbsTypeSubtype[] | Uint32Array;
+
+  /** The first timestamp to stream. Defaults to the first timestamp in the nbs files. */
+  start?: number | BigInt | NbsTimestamp;
+
+  /** The last timestamp to stream. Defaults to the last timestamp in the nbs files. */
+  end?: number | BigInt | NbsTimestamp;
+
+  /** How many packets to read at a time, one batch ahead of the packets being used. Defaults to 1024. */
+  batchSize?: number;
+}
+
+/**
+ * Options for creating a cursor
+ */
+export interface NbsCursorOptions {
+  /** The types to step through. Defaults to every type. */
+  types?: NbsTypeSubtype[] | Uint32Array;
+
+  /** Start the cursor at this timestamp, as if `seek()` was called with it. Defaults to before the first packet. */
+  timestamp?: number | BigInt | NbsTimestamp;
+}
+
+/**
+ * Steps through the packets of a decoder in timestamp order, across all types. Packets with the same timestamp are
+ * returned in type order. The cursor sits between two packets, and stepping takes constant time when it steps
+ * through every type. A cursor over only some of the types steps through their own indexes instead, so each step
+ * takes time proportional to the number of its types, however many packets of other types are in between.
+ */
+export interface NbsCursor {
+  /** Get the packet after the cursor and move past it, or undefined if there are no more packets */
+  next(): NbsPacket | undefined;
+
+  /** Get the packet before the cursor and move back over it, or undefined if there are no earlier packets */
+  prev(): NbsPacket | undefined;
+
+  /**
+   * Move the cursor so the next packet is the first one at or after the given timestamp
+   *
+   * @param timestamp The timestamp to move to
+   */
+  seek(timestamp: number | BigInt | NbsTimestamp): void;
+}
+
+/**
+ * How the packets of a type are spread over time, from `getDensity()`. Bucket `i` covers the `width` nanoseconds from
+ * `start + i * width`.
+ */
+export interface NbsDensity {
+  /** The start of the first bucket, which is a multiple of the bucket width at or before the requested start */
+  start: NbsTimestamp;
+
+  /** The width of each bucket in nanoseconds, which is a power of two */
+  width: number;
+
+  /** The number of packets in each bucket */
+  counts: Float64Array;
+
+  /** The total length of the packets in each bucket, including their headers */
+  bytes: Float64Array;
+
+  /** The timestamp of the first packet in each bucket in nanoseconds, or 0 for empty buckets */
+  min: BigUint64Array;
+
+  /** The timestamp of the last packet in each bucket in nanoseconds, or 0 for empty buckets */
+  max: BigUint64Array;
+}
+
+/**
+ * Gets the packets of a list of types at a timestamp, for a timestamp that moves a little at a time such as during
+ * playback. The cursor remembers where it found each type, and searches outwards from there, so moving a few packets
+ * takes constant time per type.
+ */
+export interface NbsTypeCursor {
+  /**
+   * Get the packets of the cursor's types at the given timestamp, the same as `getPackets()`, and move the cursor there
+   *
+   * @param timestamp The timestamp to get packets at
+   */
+  seek(timestamp: number | BigInt | NbsTimestamp): NbsPacket[];
+}
+
+/**
+ * How the timestamps of a type are searched, and how much searching has been done
+ */
+export interface NbsSearchStats {
+  /** The XX64 hash of the packet type */
+  type: Buffer;
+
+  /** The packet subtype */
+  subtype: number;
+
+  /**
+   * How the timestamps are searched: a binary search over all of them, a search tree, a binary search near an
+   * interpolated position, or a binary search over the blocks of a compact index
+   */
+  strategy: 'binary' | 'tree' | 'interpolation' | 'compact';
+
+  /** The number of timestamp searches of the type */
+  searches: number;
+
+  /** The total number of timestamps (and search tree keys) probed by those searches */
+  probes: number;
+}
+
+/**
+ * How well the packet cache of a decoder is working
+ */
+export interface NbsCacheStats {
+  /** The number of packets read from the cache */
+  hits: number;
+
+  /** The number of packets that weren't in the cache */
+  misses: number;
+
+  /** The number of packets in the cache */
+  packets: number;
+
+  /** The size of the packets in the cache, counting their payloads and an estimate of their overhead */
+  bytes: number;
+
+  /** The most bytes of packets the cache keeps, from the `packetCache` option */
+  budget: number;
+}
+
+/**
+ * The packets from `getPacketColumns()`, with each field in its own column. Packet `i` has the timestamp
+ * `timestamps[i]`, the type `types[typeIds[i]]`, and the payload
+ * `payloads.subarray(offsets[i], offsets[i] + lengths[i])`.
+ */
+export interface NbsPacketColumns {
+  /** Every type in the decoder, indexed by type id */
+  types: NbsTypeSubtypeBuffer[];
+
+  /** The timestamp of each packet in nanoseconds */
+  timestamps: BigUint64Array;
+
+  /** The type id of each packet, which is its index in `types` */
+  typeIds: Uint32Array;
+
+  /** The subtype of each packet */
+  subtypes: Uint32Array;
+
+  /** Where the payload of each packet starts in `payloads` */
+  offsets: Uint32Array;
+
+  /** The length of the payload of each packet */
+  lengths: Uint32Array;
+
+  /** The payloads of all the packets, one after the other */
+  payloads: Buffer;
+}
+
+/**
+ * The packets from `getPacketsAt()`. The packet of type `j` at timestamp `i` is `packets[indices[i * types + j]]`,
+ * where `types` is the number of types or type ids asked for, including ones that aren't in the nbs files. Types with
+ * no packet at or before a timestamp have an index of 0xFFFFFFFF there.
+ */
+export interface NbsPacketsAt {
+  /** The distinct packets, each of which may be at many of the timestamps */
+  packets: NbsPacket[];
+
+  /** Which packet each type has at each timestamp */
+  indices: Uint32Array;
+}
+
+/**
+ * A handle to the index and memory maps of a decoder, from `share()`. It can be posted to worker threads.
+ */
+export interface NbsSharedDecoder {
+  /** Identifies the shared index and memory maps within the process */
+  id: number;
+}
+
 /**
  * A decoder that can be used to read packets from NBS files
  */
@@ -75,20 +418,71 @@ export declare class NbsDecoder {
    * Create a new NbsDecoder instance
    *
    * @param paths A list of absolute paths of nbs files to decode
-   * @throws For an empty list of paths, and for paths that don't exist
+   * @param options Options for loading the nbs files
+   * @throws For an empty list of paths, and for paths that don't exist. Nbs files without an index file are scanned.
    */
-  public constructor(paths: string[]);
+  public constructor(paths: string[], options?: NbsDecoderOptions);
+
+  /**
+   * Open a new NbsDecoder, building its index on the thread pool rather than the JS thread
+   *
+   * @param paths A list of absolute paths of nbs files to decode
+   * @param options Options for loading the nbs files
+   * @returns A promise for the decoder, which rejects for paths that don't exist. Invalid arguments throw straight
+   *          away.
+   */
+  public static open(paths: string[], options?: NbsOpenOptions): Promise<NbsDecoder>;
+
+  /**
+   * Create a decoder that reads the same index and memory maps as the decoder a handle was shared from, such as one
+   * on another thread. Nothing is indexed or mapped again. The decoder has the options of the shared decoder.
+   *
+   * @param handle A handle from `share()`
+   * @throws If every decoder reading the shared index has been closed
+   */
+  public static fromShared(handle: NbsSharedDecoder): NbsDecoder;
+
+  /**
+   * Share this decoder's index and memory maps, so decoders on worker threads can be created with `fromShared()`
+   * that read them without a copy of their own. The index and maps are kept until every decoder reading them is
+   * closed. They can't change once shared, so shared decoders can't `follow()` or `evict()`.
+   *
+   * @returns A handle that can be posted to worker threads. Sharing the decoder again gives the same handle.
+   * @throws While following
+   */
+  public share(): NbsSharedDecoder;
 
   /**
    * Get all the timestamps of a specified message type subtype.
    *
    * @param typeSubtype A type subtype object to get the timestamps for
+   * @param options With `format: 'bigint'` the timestamps are returned as nanoseconds in a BigUint64Array, and with
+   *                `format: 'milliseconds'` as milliseconds in a Float64Array. These are copied straight from the
+   *                index, which is much faster than creating a timestamp object for each packet.
    */
-  public getTypeIndex(typeSubtype: NbsTypeSubtype): NbsTimestamp[];
+  public getTypeIndex(typeSubtype: NbsTypeSubtype, options?: { format?: 'object' }): NbsTimestamp[];
+  public getTypeIndex(typeSubtype: NbsTypeSubtype, options: { format: 'bigint' }): BigUint64Array;
+  public getTypeIndex(
+    typeSubtype: NbsTypeSubtype,
+    options: { format: 'milliseconds' }
+  ): Float64Array;
 
   /** Get a list of all the types present in the loaded nbs files */
   public getAvailableTypes(): NbsTypeSubtypeBuffer[];
 
+  /**
+   * Look up the ids of the given types in this decoder. Methods that take an array of types also take a Uint32Array
+   * of these ids in its place. Passing ids skips reading and hashing the type objects on every call, such as when
+   * getting the same types every frame. Methods that take a single type only take a type subtype object.
+   *
+   * Ids are only valid for this decoder, and decoders created from it with `fromShared()`.
+   *
+   * @param types The types to look up
+   * @returns The id of each type, or 0xFFFFFFFF for types that aren't in the nbs files, which are skipped when passed
+   *          in a Uint32Array
+   */
+  public resolveTypes(types: NbsTypeSubtype[]): Uint32Array;
+
   /** Get the timestamp range (start, end) across all packets in the loaded nbs files */
   public getTimestampRange(): [NbsTimestamp, NbsTimestamp];
 
@@ -99,6 +493,27 @@ export declare class NbsDecoder {
    */
   public getTimestampRange(typeSubtype: NbsTypeSubtype): [NbsTimestamp, NbsTimestamp];
 
+  /**
+   * Summarise how the packets of a type are spread from `start` to `end`, such as for drawing a timeline. The buckets
+   * have the widest power of two width that splits the range into at least `buckets` buckets, and are aligned to
+   * multiples of their width, so the first and last buckets may extend past `start` and `end`. There are between
+   * about `buckets` and 2 * `buckets` buckets.
+   *
+   * The counts come from a summary of each type at power of two widths, built the first time the type's density is
+   * asked for, so the time taken depends on the number of buckets rather than the number of packets.
+   *
+   * @param typeSubtype The type subtype object to summarise
+   * @param start       The start of the range
+   * @param end         The end of the range
+   * @param buckets     The number of buckets to split the range into
+   */
+  public getDensity(
+    typeSubtype: NbsTypeSubtype,
+    start: number | BigInt | NbsTimestamp,
+    end: number | BigInt | NbsTimestamp,
+    buckets: number
+  ): NbsDensity;
+
   /**
    * Get the packets at or before the given timestamp for all types in the loaded nbs files
    *
@@ -124,9 +539,120 @@ export declare class NbsDecoder {
    */
   public getPackets(
     timestamp: number | BigInt | NbsTimestamp,
-    types: NbsTypeSubtype[]
+    types: NbsTypeSubtype[] | Uint32Array
   ): NbsPacket[];
 
+  /**
+   * Like `getPackets()`, but reads the packets on the thread pool so the JS thread doesn't wait for them to be read
+   * from disk. The index is shared with the work on the thread pool, which carries on if the decoder is closed. This
+   * doesn't use the `packetCache`, so it always returns new packet objects.
+   *
+   * @param timestamp The timestamp to get packets at
+   * @param types A list of type subtype objects to get packets for. If unspecified, all types are included.
+   * @param options Options for aborting the call
+   */
+  public getPacketsAsync(
+    timestamp: number | BigInt | NbsTimestamp,
+    types?: NbsTypeSubtype[] | Uint32Array,
+    options?: NbsAsyncOptions
+  ): Promise<NbsPacket[]>;
+
+  /**
+   * Get the packets of the given types at each of the given timestamps, like calling `getPackets()` for each timestamp
+   * but much faster for many timestamps. The timestamps are sorted, and each type is searched from where it was found
+   * for the previous timestamp. Each packet is only returned once, however many of the timestamps it is at.
+   *
+   * @param timestamps The timestamps to get packets at, in any order. A BigUint64Array is read as nanoseconds.
+   * @param types      A list of type subtype objects to get packets for. If unspecified, all types are included.
+   */
+  public getPacketsAt(
+    timestamps: (number | BigInt | NbsTimestamp)[] | BigUint64Array,
+    types?: NbsTypeSubtype[] | Uint32Array
+  ): NbsPacketsAt;
+
+  /**
+   * Get all the packets of the given types with timestamps from `start` to `end` (inclusive), in timestamp order.
+   * Packets with the same timestamp are in the order of their types in `types`.
+   *
+   * Use `limit` and `offset` to read a large range a page at a time: each page starts `offset` packets into the range.
+   * Skipping packets is fast, so late pages cost about the same as the first one.
+   *
+   * @param start   The first timestamp of the range
+   * @param end     The last timestamp of the range
+   * @param types   A list of type subtype objects to get packets for. If unspecified, all types are included.
+   * @param options Options for limiting the number of packets returned
+   */
+  public getPacketsInRange(
+    start: number | BigInt | NbsTimestamp,
+    end: number | BigInt | NbsTimestamp,
+    types?: NbsTypeSubtype[] | Uint32Array,
+    options?: NbsRangeOptions
+  ): NbsPacket[];
+
+  /**
+   * Get the same packets as `getPacketsInRange()`, but as columns rather than an object for each packet. The payloads
+   * are copied into one Buffer, so reading many small packets doesn't create many objects to garbage collect.
+   *
+   * @param start   The first timestamp of the range
+   * @param end     The last timestamp of the range
+   * @param types   A list of type subtype objects to get packets for. If unspecified, all types are included.
+   * @param options Options for limiting the number of packets returned
+   * @throws RangeError if the payloads add up to more than 4 GiB
+   */
+  public getPacketColumns(
+    start: number | BigInt | NbsTimestamp,
+    end: number | BigInt | NbsTimestamp,
+    types?: NbsTypeSubtype[] | Uint32Array,
+    options?: NbsRangeOptions
+  ): NbsPacketColumns;
+
+  /**
+   * Like `getPacketsInRange()`, but reads the packets on the thread pool so the JS thread doesn't wait for them to be
+   * read from disk. This doesn't use the `packetCache`, so it always returns new packet objects.
+   *
+   * @param start   The first timestamp of the range
+   * @param end     The last timestamp of the range
+   * @param types   A list of type subtype objects to get packets for. If unspecified, all types are included.
+   * @param options Options for limiting the number of packets returned, and for aborting the call
+   */
+  public getPacketsInRangeAsync(
+    start: number | BigInt | NbsTimestamp,
+    end: number | BigInt | NbsTimestamp,
+    types?: NbsTypeSubtype[] | Uint32Array,
+    options?: NbsRangeAsyncOptions
+  ): Promise<NbsPacket[]>;
+
+  /**
+   * Stream the packets of the given types from `start` to `end` (inclusive) in timestamp order, for use with
+   * `for await`. Packets with the same timestamp are in the order of their types in `types`.
+   *
+   * The packets are read on the thread pool a batch at a time, and the next batch is read while the current one is
+   * being used, so reading from disk overlaps with the work done on each packet.
+   *
+   * @param options The types and range of timestamps to stream, and how to read them
+   */
+  public stream(options?: NbsStreamOptions): AsyncIterableIterator<NbsPacket>;
+
+  /**
+   * Get how well the packet cache is working. The cache is used by `getPackets()`, `getPacketsInRange()`,
+   * `getPacketByIndex()`, and cursors.
+   */
+  public getCacheStats(): NbsCacheStats;
+
+  /**
+   * Tell the OS that the packets of the given types from `start` to `end` (inclusive) will be read soon, so it can
+   * start reading them from disk in the background. Only the bytes of those packets are read.
+   *
+   * @param start The first timestamp of the range
+   * @param end   The last timestamp of the range
+   * @param types A list of type subtype objects to prefetch packets for. If unspecified, all types are included.
+   */
+  public prefetch(
+    start: number | BigInt | NbsTimestamp,
+    end: number | BigInt | NbsTimestamp,
+    types?: NbsTypeSubtype[] | Uint32Array
+  ): void;
+
   /**
    * Get the packet of the given type at the given index in the loaded nbs file.
    *
@@ -148,10 +674,64 @@ export declare class NbsDecoder {
    */
   public nextTimestamp(
     timestamp: number | BigInt | NbsTimestamp,
-    type?: NbsTypeSubtype | NbsTypeSubtype[],
+    type?: NbsTypeSubtype | NbsTypeSubtype[] | Uint32Array,
     steps?: number
   ): NbsTimestamp;
 
+  /**
+   * Create a cursor that steps through the packets in the loaded nbs files in timestamp order. The first cursor over
+   * every type builds an index of every packet in timestamp order, which takes 8 bytes per packet and is shared by
+   * all the cursors of the decoder. Cursors carry on from the same place when packets are added by `follow()`.
+   *
+   * @param options Options for the cursor
+   */
+  public cursor(options?: NbsCursorOptions): NbsCursor;
+
+  /**
+   * Create a cursor that gets the packets of the given types at a timestamp, like `getPackets()`, but searches each
+   * type from where it was last time rather than from scratch.
+   *
+   * @param types The types to get packets of. If unspecified, all types are included.
+   */
+  public typeCursor(types?: NbsTypeSubtype[] | Uint32Array): NbsTypeCursor;
+
+  /**
+   * Get how the timestamps of each available type are searched by `getPackets()` and `nextTimestamp()`, and how
+   * many timestamps those searches have probed so far. Searches are only counted for decoders opened with the
+   * `searchStats` option, and are 0 otherwise.
+   */
+  public getSearchStats(): NbsSearchStats[];
+
+  /**
+   * Release the loaded index of the given types, or of all types if none are given. They are loaded again the next
+   * time they are used. Only has an effect for decoders opened with the `lazy` option.
+   *
+   * @param types The types to release
+   * @throws For shared decoders
+   */
+  public evict(types?: NbsTypeSubtype[] | Uint32Array): void;
+
+  /**
+   * Follow the nbs files for packets appended to them, such as files that are still being recorded. New packets are
+   * added to the index as they are written, and the callback is called after each batch of them. Files that have an
+   * index file are followed through the entries appended to it, so new packets have their subtypes and message
+   * timestamps as usual. Files without an index file are followed by reading the packet headers, which don't store
+   * subtypes, so their new packets all have a subtype of 0 and the timestamps from the headers.
+   *
+   * While following, the decoder keeps the process running (like `setInterval()`) until `unfollow()` or `close()` is
+   * called.
+   *
+   * @param callback Called with each batch of new packets, after they have been added to the index
+   * @param options Options for following the files
+   * @throws For decoders opened with the `lazy` option, and shared decoders
+   */
+  public follow(callback: (event: NbsFollowEvent) => void, options?: NbsFollowOptions): void;
+
+  /**
+   * Stop following the nbs files for new packets.
+   */
+  public unfollow(): void;
+
   /**
    * Close the readers for the NBS files.
    */
@@ -4,5 +4,54 @@ const binding = bindings({
   bindings: 'nbsdecoder',
 });
 
+/**
+ * Stream the packets of the given types from `start` to `end` in timestamp order, for use with `for await`.
+ *
+ * The packets are read on the thread pool a batch at a time with `getPacketsInRangeAsync()`, and the next batch is
+ * read while the current one is being used, so reading from disk overlaps with the work done on each packet.
+ */
+binding.Decoder.prototype.stream = function stream(options = {}) {
+  if (typeof options !== 'object' || options === null) {
+    throw new TypeError('invalid argument `options`: expected object');
+  }
+
+  const { types, signal } = options;
+
+  const batchSize = options.batchSize === undefined ? 1024 : options.batchSize;
+  if (!Number.isInteger(batchSize) || batchSize <= 0) {
+    throw new TypeError('invalid option `batchSize`: expected positive integer');
+  }
+
+  const [first, last] = this.getTimestampRange();
+  const start = options.start === undefined ? first : options.start;
+  const end = options.end === undefined ? last : options.end;
+
+  const read = (offset) => {
+    const batch = this.getPacketsInRangeAsync(start, end, types, {
+      limit: batchSize,
+      offset,
+      signal,
+    });
+
+    // The batch may never be awaited if the stream is stopped early
+    batch.catch(() => {});
+    return batch;
+  };
+
+  // Start reading the first batch straight away, which also throws for invalid arguments before iterating
+  let next = read(0);
+
+  return (async function* () {
+    let offset = 0;
+    while (next) {
+      const batch = await next;
+      offset += batch.length;
+      next = batch.length === batchSize ? read(offset) : undefined;
+
+      yield* batch;
+    }
+  })();
+};
+
 module.exports.NbsDecoder = binding.Decoder;
 module.exports.NbsEncoder = binding.Encoder;
@@ -0,0 +1,119 @@
+#include "AsyncTask.hpp"
+
+namespace nbs {
+
+    AsyncTask::AsyncTask(const Napi::Env& env, Work work, Done done)
+        : Napi::AsyncWorker(env, "nbsdecoder async")
+        , deferred(Napi::Promise::Deferred::New(env))
+        , work(std::move(work))
+        , done(std::move(done))
+        , aborted(std::make_shared<std::atomic<bool>>(false)) {}
+
+    Napi::Promise AsyncTask::Run(const Napi::Env& env, const Napi::Value& signal, Work work, Done done) {
+        // The task deletes itself once it has settled the promise
+        auto task    = new AsyncTask(env, std::move(work), std::move(done));
+        auto promise = task->deferred.Promise();
+
+        if (signal.IsObject()) {
+            auto jsSignal = signal.As<Napi::Object>();
+
+            // A signal that was aborted before starting rejects straight away, without running the work
+            if (jsSignal.Get("aborted").ToBoolean()) {
+                task->deferred.Reject(AbortError(env));
+                delete task;
+                return promise;
+            }
+
+            auto addEventListener = jsSignal.Get("addEventListener");
+            if (addEventListener.IsFunction()) {
+                auto aborted  = task->aborted;
+                auto listener = Napi::Function::New(env, [aborted](const Napi::CallbackInfo& info) -> Napi::Value {
+                    *aborted = true;
+                    return info.Env().Undefined();
+                });
+
+                addEventListener.As<Napi::Function>().Call(jsSignal, {Napi::String::New(env, "abort"), listener});
+                task->signal   = Napi::Persistent(jsSignal);
+                task->listener = Napi::Persistent(listener);
+            }
+        }
+
+        task->Queue();
+        return promise;
+    }
+
+    bool AsyncTask::IsSignal(const Napi::Value& signal) {
+        return signal.IsUndefined() || (signal.IsObject() && signal.As<Napi::Object>().Has("aborted"));
+    }
+
+    void AsyncTask::Execute() {
+        try {
+            if (!*this->aborted) {
+                this->work(*this->aborted);
+            }
+        }
+        catch (const AbortedError&) {
+            // Settled as aborted below
+        }
+        catch (const std::exception& ex) {
+            this->SetError(ex.what());
+        }
+    }
+
+    void AsyncTask::OnOK() {
+        Napi::Env env = this->Env();
+        Napi::HandleScope scope(env);
+
+        this->Unlisten();
+
+        if (*this->aborted) {
+            this->deferred.Reject(AbortError(env));
+            return;
+        }
+
+#ifdef NAPI_CPP_EXCEPTIONS
+        try {
+            this->deferred.Resolve(this->done(env));
+        }
+        catch (const Napi::Error& error) {
+            this->deferred.Reject(error.Value());
+        }
+#else
+        this->deferred.Resolve(this->done(env));
+#endif
+    }
+
+    void AsyncTask::OnError(const Napi::Error& error) {
+        Napi::Env env = this->Env();
+        Napi::HandleScope scope(env);
+
+        this->Unlisten();
+        this->deferred.Reject(*this->aborted ? AbortError(env) : error.Value());
+    }
+
+    void AsyncTask::Unlisten() {
+        if (this->signal.IsEmpty()) {
+            return;
+        }
+
+        auto jsSignal            = this->signal.Value();
+        auto removeEventListener = jsSignal.Get("removeEventListener");
+        if (removeEventListener.IsFunction()) {
+            removeEventListener.As<Napi::Function>().Call(
+                jsSignal,
+                {Napi::String::New(this->Env(), "abort"), this->listener.Value()});
+        }
+
+        this->signal.Reset();
+        this->listener.Reset();
+    }
+
+    Napi::Value AsyncTask::AbortError(const Napi::Env& env) {
+        // Match the errors node rejects with when its own APIs are aborted
+        auto error = Napi::Error::New(env, AbortedError().what()).Value();
+        error.Set("name", Napi::String::New(env, "AbortError"));
+        error.Set("code", Napi::String::New(env, "ABORT_ERR"));
+        return error;
+    }
+
+}  // namespace nbs
@@ -0,0 +1,77 @@
+#ifndef NBS_ASYNCTASK_HPP
+#define NBS_ASYNCTASK_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <napi.h>
+#include <stdexcept>
+#include <string>
+
+namespace nbs {
+
+    /// Thrown by the work of an AsyncTask to stop early when it has been aborted
+    class AbortedError : public std::runtime_error {
+    public:
+        AbortedError() : std::runtime_error("The operation was aborted") {}
+    };
+
+    /**
+     * Runs work on the libuv thread pool, and settles a promise with the result on the JS thread.
+     *
+     * The work can be aborted with an AbortSignal (or any object with an `aborted` property and the
+     * `addEventListener()` and `removeEventListener()` methods of one). Aborting sets a flag the work can check to stop
+     * early, and rejects the promise with an `AbortError` even if the work finished anyway.
+     */
+    class AsyncTask : public Napi::AsyncWorker {
+    public:
+        /// Runs on a worker thread, and may throw std::exception to reject the promise. It is given the flag that is
+        /// set when the task is aborted.
+        using Work = std::function<void(const std::atomic<bool>& aborted)>;
+
+        /// Runs on the JS thread after the work succeeds, returning the value to resolve the promise with
+        using Done = std::function<Napi::Value(const Napi::Env& env)>;
+
+        /**
+         * Start running a task
+         *
+         * @param env    the JS environment
+         * @param signal the AbortSignal to abort the task with, or undefined
+         * @param work   the work to run on the thread pool
+         * @param done   called on the JS thread to get the result of the work
+         * @return       a promise for the result
+         */
+        static Napi::Promise Run(const Napi::Env& env, const Napi::Value& signal, Work work, Done done);
+
+        /// Check if the given value is undefined or can be used as the signal of a task
+        static bool IsSignal(const Napi::Value& signal);
+
+    protected:
+        void Execute() override;
+        void OnOK() override;
+        void OnError(const Napi::Error& error) override;
+
+    private:
+        AsyncTask(const Napi::Env& env, Work work, Done done);
+
+        Napi::Promise::Deferred deferred;
+        Work work;
+        Done done;
+
+        /// Set when the signal is aborted, shared with the signal's listener which may outlive the task
+        std::shared_ptr<std::atomic<bool>> aborted;
+
+        /// The signal and the listener added to it, so the listener can be removed when the task is done
+        Napi::ObjectReference signal;
+        Napi::FunctionReference listener;
+
+        /// Stop listening to the signal
+        void Unlisten();
+
+        /// Create the error to reject the promise with when the task is aborted
+        static Napi::Value AbortError(const Napi::Env& env);
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_ASYNCTASK_HPP
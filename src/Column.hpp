@@ -0,0 +1,102 @@
+#ifndef NBS_COLUMN_HPP
+#define NBS_COLUMN_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace nbs {
+
+    /**
+     * A contiguous, read only array of values. A column either owns its values, or is a view of values stored
+     * elsewhere (such as in a memory mapped index cache) that must outlive it.
+     */
+    template <typename T>
+    class Column {
+    public:
+        Column() = default;
+
+        /// Create a column that owns the given values
+        explicit Column(std::vector<T>&& values)
+            : storage(std::move(values)), values(storage.data()), count(storage.size()) {}
+
+        /// Create a column that views `count` values stored elsewhere
+        Column(const T* values, const size_t& count) : values(values), count(count) {}
+
+        Column(const Column& other) : storage(other.storage), values(other.values), count(other.count) {
+            // Point at our own copy of the values if the other column owned them
+            if (!storage.empty()) {
+                values = storage.data();
+            }
+        }
+
+        Column(Column&& other) noexcept
+            : storage(std::move(other.storage)), values(other.values), count(other.count) {
+            other.values = nullptr;
+            other.count  = 0;
+        }
+
+        Column& operator=(Column other) noexcept {
+            std::swap(storage, other.storage);
+            std::swap(values, other.values);
+            std::swap(count, other.count);
+            return *this;
+        }
+
+        /// Add values to the end of the column, first copying the values into the column if it is a view
+        void append(const T* more, const size_t& moreCount) {
+            if (values != storage.data()) {
+                storage.assign(values, values + count);
+            }
+
+            storage.insert(storage.end(), more, more + moreCount);
+            values = storage.data();
+            count  = storage.size();
+        }
+
+        const T* data() const {
+            return values;
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        const T& operator[](const size_t& i) const {
+            return values[i];
+        }
+
+        const T* begin() const {
+            return values;
+        }
+
+        const T* end() const {
+            return values + count;
+        }
+
+        const T& front() const {
+            return values[0];
+        }
+
+        const T& back() const {
+            return values[count - 1];
+        }
+
+    private:
+        /// The values, if this column owns them
+        std::vector<T> storage;
+
+        /// Points to the first value, either in `storage` or elsewhere
+        const T* values = nullptr;
+
+        /// The number of values in the column
+        size_t count = 0;
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_COLUMN_HPP
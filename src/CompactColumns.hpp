@@ -0,0 +1,299 @@
+#ifndef NBS_COMPACTCOLUMNS_HPP
+#define NBS_COMPACTCOLUMNS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SearchStats.hpp"
+
+namespace nbs {
+
+    /**
+     * The index items of a single type, encoded into blocks to take a fraction of the memory of plain columns.
+     *
+     * Each block holds BLOCK_SIZE items. The first timestamp, first offset, and file number of each block are kept
+     * uncompressed, and each item in the block is then stored as variable length integers:
+     *
+     * Name      | Encoding                  |  Description
+     * ------------------------------------------------------------
+     * timestamp | varint                    | the difference from the previous item's timestamp
+     * offset    | zigzag varint             | the difference from the previous item's offset, which can be negative
+     * length    | varint                    | the length of the packet
+     * fileno    | varint                    | the file number, only stored if the block's items are in several files
+     *
+     * The first item of a block is encoded against the block's own first timestamp and offset. Finding an item means
+     * finding its block and decoding the block up to it, so searching by timestamp is a binary search over the first
+     * timestamp of each block followed by a scan of at most one block.
+     */
+    class CompactColumns {
+    public:
+        /// The number of items in each block
+        static constexpr size_t BLOCK_SIZE = 64;
+
+        /// An item decoded from the blocks
+        struct Entry {
+            uint64_t timestamp;
+            uint64_t offset;
+            uint32_t length;
+            uint32_t fileno;
+        };
+
+        CompactColumns() = default;
+
+        /**
+         * Encode the given items
+         *
+         * @param timestamps the timestamp of each item, sorted in ascending order
+         * @param offsets    the offset of each item's packet
+         * @param lengths    the length of each item's packet
+         * @param filenos    the file number of each item's packet
+         * @param count      the number of items
+         */
+        CompactColumns(const uint64_t* timestamps,
+                       const uint64_t* offsets,
+                       const uint32_t* lengths,
+                       const uint32_t* filenos,
+                       const size_t& count) {
+            addBlocks(timestamps, offsets, lengths, filenos, count);
+
+            firsts.shrink_to_fit();
+            blocks.shrink_to_fit();
+            bytes.shrink_to_fit();
+        }
+
+        /// Get the number of items
+        size_t size() const {
+            return count;
+        }
+
+        /// Get the number of bytes of memory used by the encoded items
+        size_t memory() const {
+            return firsts.capacity() * sizeof(uint64_t) + blocks.capacity() * sizeof(Block) + bytes.capacity();
+        }
+
+        /**
+         * Add items after the existing items. Only the last block is encoded again, so appending is cheap.
+         *
+         * @param timestamps the timestamp of each item, sorted in ascending order and not before any existing item
+         * @param offsets    the offset of each item's packet
+         * @param lengths    the length of each item's packet
+         * @param filenos    the file number of each item's packet
+         * @param moreCount  the number of items
+         */
+        void append(const uint64_t* timestamps,
+                    const uint64_t* offsets,
+                    const uint32_t* lengths,
+                    const uint32_t* filenos,
+                    const size_t& moreCount) {
+            // Take the last block apart if it isn't full, and encode its items again along with the new ones
+            std::vector<uint64_t> allTimestamps;
+            std::vector<uint64_t> allOffsets;
+            std::vector<uint32_t> allLengths;
+            std::vector<uint32_t> allFilenos;
+
+            const size_t partial = count % BLOCK_SIZE;
+            if (partial != 0) {
+                forEach(count - partial, count, [&](const Entry& entry) {
+                    allTimestamps.push_back(entry.timestamp);
+                    allOffsets.push_back(entry.offset);
+                    allLengths.push_back(entry.length);
+                    allFilenos.push_back(entry.fileno);
+                });
+
+                bytes.resize(blocks.back().data);
+                firsts.pop_back();
+                blocks.pop_back();
+                count -= partial;
+            }
+
+            allTimestamps.insert(allTimestamps.end(), timestamps, timestamps + moreCount);
+            allOffsets.insert(allOffsets.end(), offsets, offsets + moreCount);
+            allLengths.insert(allLengths.end(), lengths, lengths + moreCount);
+            allFilenos.insert(allFilenos.end(), filenos, filenos + moreCount);
+
+            addBlocks(allTimestamps.data(),
+                      allOffsets.data(),
+                      allLengths.data(),
+                      allFilenos.data(),
+                      allTimestamps.size());
+        }
+
+        /// Call `fn` with each item in [begin, end), in order
+        template <typename F>
+        void forEach(const size_t& begin, const size_t& end, F&& fn) const {
+            Reader reader;
+
+            for (size_t position = begin - begin % BLOCK_SIZE; position < end; position++) {
+                if (position % BLOCK_SIZE == 0) {
+                    reader = Reader(*this, position / BLOCK_SIZE);
+                }
+
+                reader.next();
+                if (position >= begin) {
+                    fn(reader.entry);
+                }
+            }
+        }
+
+        /// Get the item at the given position
+        Entry get(const size_t& position) const {
+            Entry entry{};
+            forEach(position, position + 1, [&](const Entry& found) { entry = found; });
+            return entry;
+        }
+
+        /**
+         * Get the position of the first item with a timestamp greater than the given timestamp
+         *
+         * @param timestamp the timestamp to search for
+         * @param probes    incremented for each block timestamp probed and each item decoded
+         * @return          the position of the first greater timestamp, or `size()` if there is none
+         */
+        size_t upperBound(const uint64_t& timestamp, size_t& probes) const {
+            // Every item in the blocks from the first block that starts after the timestamp is too late, and every
+            // item in the blocks before the one just before it is too early
+            const size_t block = probedUpperBound(firsts.data(), firsts.data() + firsts.size(), timestamp, probes)
+                                 - firsts.data();
+            if (block == 0) {
+                return 0;
+            }
+
+            Reader reader(*this, block - 1);
+            size_t position  = (block - 1) * BLOCK_SIZE;
+            const size_t end = std::min(block * BLOCK_SIZE, count);
+            for (; position < end; position++) {
+                reader.next();
+                probes++;
+                if (reader.entry.timestamp > timestamp) {
+                    break;
+                }
+            }
+
+            return position;
+        }
+
+    private:
+        /// Marks a block whose items are in more than one file
+        static constexpr uint32_t MIXED_FILES = 0xFFFFFFFF;
+
+        /// Where each block starts
+        struct Block {
+            /// The offset of the first item
+            uint64_t offset;
+
+            /// The position of the block's encoded items in `bytes`
+            uint64_t data;
+
+            /// The file number of every item, or MIXED_FILES if each item has its own
+            uint32_t fileno;
+        };
+
+        /// Decodes the items of a block one at a time
+        struct Reader {
+            Entry entry{};
+            const uint8_t* data = nullptr;
+            bool mixed          = false;
+
+            Reader() = default;
+
+            Reader(const CompactColumns& columns, const size_t& block) {
+                auto& start     = columns.blocks[block];
+                entry.timestamp = columns.firsts[block];
+                entry.offset    = start.offset;
+                entry.fileno    = start.fileno;
+                data            = columns.bytes.data() + start.data;
+                mixed           = start.fileno == MIXED_FILES;
+            }
+
+            /// Decode the next item into `entry`
+            void next() {
+                entry.timestamp += readVarint(data);
+
+                const uint64_t offset = readVarint(data);
+                entry.offset += (offset >> 1) ^ (0 - (offset & 1));
+
+                entry.length = uint32_t(readVarint(data));
+                if (mixed) {
+                    entry.fileno = uint32_t(readVarint(data));
+                }
+            }
+        };
+
+        /// The first timestamp of each block, kept apart from the rest so searching them stays in the cache
+        std::vector<uint64_t> firsts;
+
+        /// The start of each block
+        std::vector<Block> blocks;
+
+        /// The encoded items of every block
+        std::vector<uint8_t> bytes;
+
+        /// The number of items
+        size_t count = 0;
+
+        /// Encode the given items into new blocks. The last existing block must be full.
+        void addBlocks(const uint64_t* timestamps,
+                       const uint64_t* offsets,
+                       const uint32_t* lengths,
+                       const uint32_t* filenos,
+                       const size_t& itemCount) {
+            for (size_t begin = 0; begin < itemCount; begin += BLOCK_SIZE) {
+                const size_t end = std::min(begin + BLOCK_SIZE, itemCount);
+
+                Block block{offsets[begin], bytes.size(), filenos[begin]};
+                for (size_t i = begin; i < end; i++) {
+                    if (filenos[i] != block.fileno) {
+                        block.fileno = MIXED_FILES;
+                    }
+                }
+
+                uint64_t timestamp = timestamps[begin];
+                uint64_t offset    = offsets[begin];
+                for (size_t i = begin; i < end; i++) {
+                    const uint64_t offsetDelta = offsets[i] - offset;
+
+                    writeVarint(timestamps[i] - timestamp);
+                    writeVarint((offsetDelta << 1) ^ (0 - (offsetDelta >> 63)));
+                    writeVarint(lengths[i]);
+                    if (block.fileno == MIXED_FILES) {
+                        writeVarint(filenos[i]);
+                    }
+
+                    timestamp = timestamps[i];
+                    offset    = offsets[i];
+                }
+
+                firsts.push_back(timestamps[begin]);
+                blocks.push_back(block);
+            }
+
+            count += itemCount;
+        }
+
+        /// Write a variable length integer, with 7 bits in each byte and the top bit set on all but the last byte
+        void writeVarint(uint64_t value) {
+            while (value >= 0x80) {
+                bytes.push_back(uint8_t(value) | 0x80);
+                value >>= 7;
+            }
+            bytes.push_back(uint8_t(value));
+        }
+
+        /// Read a variable length integer, moving `data` past it
+        static uint64_t readVarint(const uint8_t*& data) {
+            uint64_t value = 0;
+            int shift      = 0;
+            while (*data & 0x80) {
+                value |= uint64_t(*data++ & 0x7F) << shift;
+                shift += 7;
+            }
+            value |= uint64_t(*data++) << shift;
+            return value;
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_COMPACTCOLUMNS_HPP
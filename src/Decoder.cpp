@@ -1,9 +1,24 @@
 #include "Decoder.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <limits>
+#include <mutex>
 #include <napi.h>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include "AsyncTask.hpp"
 #include "Hash.hpp"
 #include "IndexItem.hpp"
 #include "Packet.hpp"
@@ -12,7 +27,72 @@
 
 namespace nbs {
 
+    namespace {
+        /// Files that have already been opened, handed to the constructor by open() and fromShared(). JS code can't
+        /// make Externals, so it can't pass files of its own.
+        using OpenedFiles = Napi::External<std::shared_ptr<DecoderFiles>>;
+
+        /// Construct a decoder that reads the given files, which have already been opened
+        Napi::Value NewDecoder(const Napi::FunctionReference& constructor,
+                               const Napi::Env& env,
+                               std::shared_ptr<DecoderFiles> files) {
+            auto opened = OpenedFiles::New(env,
+                                           new std::shared_ptr<DecoderFiles>(std::move(files)),
+                                           [](Napi::Env, std::shared_ptr<DecoderFiles>* files) { delete files; });
+            return constructor.New({opened});
+        }
+
+        /// The files of each shared decoder by the id of their handle, for decoders on other threads to open. Only weak
+        /// references are kept, so the files are released once every decoder reading them is closed.
+        struct SharedFiles {
+            std::mutex mutex;
+            std::unordered_map<uint64_t, std::weak_ptr<DecoderFiles>> files;
+            uint64_t nextId = 1;
+        };
+
+        SharedFiles& GetSharedFiles() {
+            // Never destroyed, since worker threads may still be using it while the process exits
+            static SharedFiles* shared = new SharedFiles();
+            return *shared;
+        }
+
+        /// Read a byte from each page of the given memory, so any pages that aren't in memory are read in now
+        void TouchPages(const uint8_t* data, const size_t& length) {
+            if (length == 0) {
+                return;
+            }
+
+            constexpr size_t PAGE_BYTES = 4096;
+            volatile uint8_t sink       = 0;
+            for (size_t i = 0; i < length; i += PAGE_BYTES) {
+                sink = sink ^ data[i];
+            }
+            sink = sink ^ data[length - 1];
+        }
+
+        /// Read the payload of a packet on the current thread, so giving it to JS doesn't page fault on the JS thread.
+        /// A payload that points into a memory map has each of its pages touched, and any other payload is copied into
+        /// memory the packet owns.
+        void LoadPayload(Packet& packet) {
+            if (packet.length == 0) {
+                return;
+            }
+
+            if (packet.owner) {
+                TouchPages(packet.payload, packet.length);
+            }
+            else {
+                std::shared_ptr<uint8_t> copy(new uint8_t[packet.length], std::default_delete<uint8_t[]>());
+                std::memcpy(copy.get(), packet.payload, packet.length);
+                packet.payload = copy.get();
+                packet.owner   = std::move(copy);
+            }
+        }
+    }  // namespace
+
     Napi::Object Decoder::Init(Napi::Env& env, Napi::Object& exports) {
+        Napi::FunctionReference* constructor = new Napi::FunctionReference();
+
         Napi::Function func = DefineClass(
             env,
             "Decoder",
@@ -20,22 +100,57 @@ namespace nbs {
                 InstanceMethod<&Decoder::GetAvailableTypes>(
                     "getAvailableTypes",
                     napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetDensity>("getDensity",
+                                                     napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::GetTimestampRange>(
                     "getTimestampRange",
                     napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::ResolveTypes>("resolveTypes",
+                                                       napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::GetTypeIndex>("getTypeIndex",
                                                        napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::GetPackets>("getPackets",
                                                      napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetPacketsAt>("getPacketsAt",
+                                                       napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetPacketsAsync>("getPacketsAsync",
+                                                          napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetPacketsInRange>(
+                    "getPacketsInRange",
+                    napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetPacketsInRangeAsync>(
+                    "getPacketsInRangeAsync",
+                    napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetPacketColumns>("getPacketColumns",
+                                                           napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::GetPacketByIndex>("getPacketByIndex",
                                                            napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::NextTimestamp>("nextTimestamp",
                                                         napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetSearchStats>("getSearchStats",
+                                                          napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::Cursor>("cursor", napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::TypeCursor>("typeCursor",
+                                                     napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::GetCacheStats>("getCacheStats",
+                                                        napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::Prefetch>("prefetch",
+                                                   napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::Evict>("evict", napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::Follow>("follow", napi_property_attributes(napi_writable | napi_configurable)),
+                InstanceMethod<&Decoder::Unfollow>("unfollow",
+                                                   napi_property_attributes(napi_writable | napi_configurable)),
                 InstanceMethod<&Decoder::Close>("close", napi_property_attributes(napi_writable | napi_configurable)),
+                // open() constructs the decoder once its files are open, so it is given the constructor
+                StaticMethod<&Decoder::Open>("open",
+                                             napi_property_attributes(napi_writable | napi_configurable),
+                                             constructor),
+                InstanceMethod<&Decoder::Share>("share", napi_property_attributes(napi_writable | napi_configurable)),
+                StaticMethod<&Decoder::FromShared>("fromShared",
+                                                   napi_property_attributes(napi_writable | napi_configurable),
+                                                   constructor),
             });
 
-        Napi::FunctionReference* constructor = new Napi::FunctionReference();
-
         // Create a persistent reference to the class constructor. This will allow
         // a function called on a class prototype and a function
         // called on instance of a class to be distinguished from each other.
@@ -60,16 +175,142 @@ namespace nbs {
     Decoder::Decoder(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Decoder>(info) {
         Napi::Env env = info.Env();
 
+        // Take the files open() or fromShared() has already opened, leaving nothing for the External to keep alive
+        if (info[0].IsExternal()) {
+            this->files = std::move(*info[0].As<OpenedFiles>().Data());
+            this->packetCache.reset(new PacketCache(this->files->options.packetCache));
+            return;
+        }
+
+        std::vector<std::string> paths;
+        IndexOptions indexOptions;
+        ReadOptions readOptions;
+        if (!ParseOpenArguments(info, paths, indexOptions, readOptions)) {
+            return;
+        }
+
+        try {
+            this->files = DecoderFiles::Open(paths, indexOptions, readOptions);
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return;
+        }
+
+        this->packetCache.reset(new PacketCache(readOptions.packetCache));
+    }
+
+    Napi::Value Decoder::Open(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::vector<std::string> paths;
+        IndexOptions indexOptions;
+        ReadOptions readOptions;
+        if (!ParseOpenArguments(info, paths, indexOptions, readOptions)) {
+            return env.Undefined();
+        }
+
+        auto signal = info[1].IsObject() ? info[1].As<Napi::Object>().Get("signal") : env.Undefined();
+        if (!AsyncTask::IsSignal(signal)) {
+            Napi::TypeError::New(env, "invalid option `signal`: expected AbortSignal").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        auto constructor = static_cast<Napi::FunctionReference*>(info.Data());
+        auto files       = std::make_shared<std::shared_ptr<DecoderFiles>>();
+
+        return AsyncTask::Run(
+            env,
+            signal,
+            [files, paths, indexOptions, readOptions](const std::atomic<bool>&) {
+                *files = DecoderFiles::Open(paths, indexOptions, readOptions);
+            },
+            [files, constructor](const Napi::Env& env) -> Napi::Value {
+                return NewDecoder(*constructor, env, std::move(*files));
+            });
+    }
+
+    Napi::Value Decoder::Share(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        // Following changes the index, which the decoders sharing it read without locking
+        if (this->follower) {
+            Napi::Error::New(env, "share() is not supported while following").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        auto& shared = GetSharedFiles();
+        uint64_t id  = 0;
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+
+            // Sharing the same files again gives the same handle
+            id = this->files->sharedId;
+            if (id == 0) {
+                // Forget the handles of files that have since been released
+                for (auto it = shared.files.begin(); it != shared.files.end();) {
+                    it = it->second.expired() ? shared.files.erase(it) : std::next(it);
+                }
+
+                id                    = shared.nextId++;
+                shared.files[id]      = this->files;
+                this->files->sharedId = id;
+            }
+        }
+
+        auto handle = Napi::Object::New(env);
+        handle.Set("id", Napi::Number::New(env, double(id)));
+        return handle;
+    }
+
+    Napi::Value Decoder::FromShared(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        auto jsId = info[0].IsObject() ? info[0].As<Napi::Object>().Get("id") : env.Undefined();
+        if (!jsId.IsNumber() || jsId.As<Napi::Number>().DoubleValue() < 1) {
+            Napi::TypeError::New(env, "invalid argument `handle`: expected handle from share()")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::shared_ptr<DecoderFiles> files;
+        {
+            auto& shared = GetSharedFiles();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+
+            auto found = shared.files.find(uint64_t(jsId.As<Napi::Number>().Int64Value()));
+            if (found != shared.files.end()) {
+                files = found->second.lock();
+            }
+        }
+
+        if (!files) {
+            Napi::Error::New(env, "the shared decoder has been closed").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // The constructor is the one for this thread's instance of the addon
+        auto constructor = static_cast<Napi::FunctionReference*>(info.Data());
+
+        return NewDecoder(*constructor, env, std::move(files));
+    }
+
+    bool Decoder::ParseOpenArguments(const Napi::CallbackInfo& info,
+                                     std::vector<std::string>& paths,
+                                     IndexOptions& indexOptions,
+                                     ReadOptions& readOptions) {
+        Napi::Env env = info.Env();
+
         // Validate the `paths` argument
         if (info.Length() == 0) {
             Napi::TypeError::New(env, "missing argument `paths`: provide an array of nbs file paths")
                 .ThrowAsJavaScriptException();
-            return;
+            return false;
         }
 
         if (!info[0].IsArray()) {
             Napi::TypeError::New(env, "invalid argument `paths`: expected array").ThrowAsJavaScriptException();
-            return;
+            return false;
         }
 
         auto argPaths = info[0].As<Napi::Array>();
@@ -77,11 +318,9 @@ namespace nbs {
         if (argPaths.Length() == 0) {
             Napi::TypeError::New(env, "invalid argument `paths`: expected non-empty array")
                 .ThrowAsJavaScriptException();
-            return;
+            return false;
         }
 
-        std::vector<std::string> paths;
-
         // Get the nbs file paths
         for (std::size_t i = 0; i < argPaths.Length(); i++) {
             auto item = argPaths.Get(i);
@@ -89,25 +328,231 @@ namespace nbs {
             if (!item.IsString()) {
                 Napi::TypeError::New(env, "invalid item in `paths` array: expected string")
                     .ThrowAsJavaScriptException();
-                return;
+                return false;
             }
 
             paths.push_back(item.As<Napi::String>().Utf8Value());
         }
 
+        // Validate the optional `options` argument
+        if (info.Length() > 1 && !info[1].IsUndefined()) {
+            if (!info[1].IsObject()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto options    = info[1].As<Napi::Object>();
+            auto indexCache = options.Get("indexCache");
+
+            if (indexCache.IsString()) {
+                indexOptions.cachePath = indexCache.As<Napi::String>().Utf8Value();
+            }
+            else if (indexCache.IsBoolean()) {
+                // Keep the cache next to the first file when no path is given
+                indexOptions.cachePath = indexCache.As<Napi::Boolean>().Value() ? paths.front() + ".idxcache" : "";
+            }
+            else if (!indexCache.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `indexCache`: expected string or boolean")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto writeScannedIndex = options.Get("writeScannedIndex");
+            if (writeScannedIndex.IsBoolean()) {
+                indexOptions.writeScannedIndex = writeScannedIndex.As<Napi::Boolean>().Value();
+            }
+            else if (!writeScannedIndex.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `writeScannedIndex`: expected boolean")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto lazy = options.Get("lazy");
+            if (lazy.IsBoolean()) {
+                indexOptions.lazy = lazy.As<Napi::Boolean>().Value();
+            }
+            else if (!lazy.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `lazy`: expected boolean").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto jsZeroCopy = options.Get("zeroCopy");
+            if (jsZeroCopy.IsBoolean()) {
+                readOptions.zeroCopy = jsZeroCopy.As<Napi::Boolean>().Value();
+            }
+            else if (!jsZeroCopy.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `zeroCopy`: expected boolean").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto packetCache = options.Get("packetCache");
+            if (packetCache.IsNumber() && packetCache.As<Napi::Number>().DoubleValue() >= 0) {
+                double bytes = packetCache.As<Napi::Number>().DoubleValue();
+
+                // Infinity (or anything too large to be a size) means never drop packets from the cache
+                readOptions.packetCache = bytes >= double((std::numeric_limits<size_t>::max)())
+                                              ? (std::numeric_limits<size_t>::max)()
+                                              : size_t(bytes);
+            }
+            else if (!packetCache.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `packetCache`: expected non-negative number")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto accessPattern = options.Get("accessPattern");
+            auto pattern = accessPattern.IsString() ? accessPattern.As<Napi::String>().Utf8Value() : std::string();
+            if (pattern == "normal" || pattern == "sequential" || pattern == "random") {
+                readOptions.accessPattern = pattern == "sequential" ? AccessPattern::SEQUENTIAL
+                                            : pattern == "random"   ? AccessPattern::RANDOM
+                                                                    : AccessPattern::NORMAL;
+            }
+            else if (!accessPattern.IsUndefined()) {
+                Napi::TypeError::New(env,
+                                     "invalid option `accessPattern`: expected 'normal', 'sequential', or 'random'")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto populate = options.Get("populate");
+            if (populate.IsNumber() && populate.As<Napi::Number>().DoubleValue() >= 0) {
+                double bytes = populate.As<Napi::Number>().DoubleValue();
+
+                // Infinity (or anything too large to be a size) means populate every file
+                readOptions.populate = bytes >= double((std::numeric_limits<uint64_t>::max)())
+                                           ? (std::numeric_limits<uint64_t>::max)()
+                                           : uint64_t(bytes);
+            }
+            else if (!populate.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `populate`: expected non-negative number")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto hugePages = options.Get("hugePages");
+            if (hugePages.IsBoolean()) {
+                readOptions.hugePages = hugePages.As<Napi::Boolean>().Value();
+            }
+            else if (!hugePages.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `hugePages`: expected boolean").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto compactIndex = options.Get("compactIndex");
+            if (compactIndex.IsBoolean()) {
+                indexOptions.compact = compactIndex.As<Napi::Boolean>().Value();
+            }
+            else if (!compactIndex.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `compactIndex`: expected boolean")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto interpolationSearch = options.Get("interpolationSearch");
+            if (interpolationSearch.IsBoolean()) {
+                indexOptions.interpolationSearch = interpolationSearch.As<Napi::Boolean>().Value();
+            }
+            else if (!interpolationSearch.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `interpolationSearch`: expected boolean")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto searchStats = options.Get("searchStats");
+            if (searchStats.IsBoolean()) {
+                indexOptions.searchStats = searchStats.As<Napi::Boolean>().Value();
+            }
+            else if (!searchStats.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `searchStats`: expected boolean")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto searchTreeThreshold = options.Get("searchTreeThreshold");
+            if (searchTreeThreshold.IsNumber() && searchTreeThreshold.As<Napi::Number>().DoubleValue() >= 0) {
+                double threshold = searchTreeThreshold.As<Napi::Number>().DoubleValue();
+
+                // Infinity (or anything too large to be a size) means never build a search tree
+                indexOptions.searchTreeThreshold =
+                    threshold >= double((std::numeric_limits<size_t>::max)()) ? (std::numeric_limits<size_t>::max)()
+                                                                              : size_t(threshold);
+            }
+            else if (!searchTreeThreshold.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `searchTreeThreshold`: expected non-negative number")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::shared_ptr<DecoderFiles> DecoderFiles::Open(const std::vector<std::string>& paths,
+                                                     const IndexOptions& options,
+                                                     const ReadOptions& readOptions) {
+        auto files     = std::make_shared<DecoderFiles>();
+        files->paths   = paths;
+        files->options = readOptions;
+
         // Make an index for all the files
-        try {
-            this->index = Index(paths);
+        files->index = Index(paths, options);
+
+        // Memory map each nbs file for reading packets later. Empty files can't be mapped, but they are left
+        // unmapped rather than failing since they may be mapped later if they grow while being followed.
+        for (auto& path : paths) {
+            std::error_code error;
+            files->memoryMaps.push_back(files->Map(path, error));
+
+            if (error && cache::statFile(path).first != 0) {
+                throw std::runtime_error("unable to memory map nbs file: " + path);
+            }
         }
-        catch (const std::exception& e) {
-            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
-            return;
+
+        return files;
+    }
+
+    Napi::Value Decoder::ResolveTypes(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!info[0].IsArray()) {
+            Napi::TypeError::New(env, "invalid type for argument `types`: expected array").ThrowAsJavaScriptException();
+            return env.Undefined();
         }
 
-        // Memory map each nbs file for reading packets later
-        for (auto& path : paths) {
-            this->memoryMaps.emplace_back(path, 0, mio::map_entire_file);
+        auto argTypes = info[0].As<Napi::Array>();
+        auto ids      = Napi::Uint32Array::New(env, argTypes.Length());
+
+        for (std::size_t i = 0; i < argTypes.Length(); i++) {
+            try {
+                ids[i] = this->files->index.getTypeId(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+            }
+            catch (const std::exception& ex) {
+                Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                    .ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
         }
+
+        return ids;
+    }
+
+    bool Decoder::IsTypeIds(const Napi::Value& value) {
+        return value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_uint32_array;
+    }
+
+    std::vector<TypeSubtype> Decoder::TypesFromJsIds(const Napi::Value& jsIds) const {
+        auto ids   = jsIds.As<Napi::Uint32Array>();
+        auto count = this->files->index.getTypeCount();
+
+        std::vector<TypeSubtype> types;
+        types.reserve(ids.ElementLength());
+        for (size_t i = 0; i < ids.ElementLength(); i++) {
+            if (ids[i] < count) {
+                types.push_back(this->files->index.getType(ids[i]));
+            }
+        }
+
+        return types;
     }
 
     Napi::Value Decoder::GetTypeIndex(const Napi::CallbackInfo& info) {
@@ -123,12 +568,56 @@ namespace nbs {
             return env.Undefined();
         }
 
-        auto typeIterator = this->index.getIteratorForType(typeSubtype);
-        auto timestamps   = Napi::Array::New(env, std::distance(typeIterator.first, typeIterator.second));
+        std::string format = "object";
+        if (!info[1].IsUndefined()) {
+            auto jsFormat = info[1].IsObject() ? info[1].As<Napi::Object>().Get("format") : Napi::Value();
+            if (jsFormat.IsEmpty()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            if (!jsFormat.IsUndefined()) {
+                format = jsFormat.IsString() ? jsFormat.As<Napi::String>().Utf8Value() : "";
+                if (format != "object" && format != "bigint" && format != "milliseconds") {
+                    Napi::TypeError::New(env,
+                                         "invalid option `format`: expected 'object', 'bigint', or 'milliseconds'")
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+        }
+
+        auto columns      = this->files->index.getColumnsForType(typeSubtype);
+        const size_t size = columns != nullptr ? columns->size() : 0;
+
+        // The typed array formats copy the timestamp column straight into the array, without an object per packet
+        if (format == "bigint") {
+            auto timestamps = Napi::BigUint64Array::New(env, size);
+            if (size > 0) {
+                columns->copyTimestamps(0, size, timestamps.Data());
+            }
+            return timestamps;
+        }
+        if (format == "milliseconds") {
+            auto timestamps = Napi::Float64Array::New(env, size);
+            // Convert a chunk of timestamps at a time, so the column is still copied in large blocks
+            uint64_t chunk[1024];
+            for (size_t begin = 0; begin < size; begin += 1024) {
+                const size_t end = std::min(size, begin + 1024);
+                columns->copyTimestamps(begin, end, chunk);
+                for (size_t i = begin; i < end; i++) {
+                    timestamps[i] = double(chunk[i - begin]) / 1e6;
+                }
+            }
+            return timestamps;
+        }
+
+        auto timestamps = Napi::Array::New(env, size);
 
-        uint64_t idx = 0;
-        for (auto it = typeIterator.first; it != typeIterator.second; it++) {
-            timestamps[idx++] = timestamp::ToJsValue(it->item.timestamp, env);
+        if (columns != nullptr) {
+            uint32_t idx = 0;
+            columns->forEach(0, columns->size(), [&](const IndexItemFile& itemFile) {
+                timestamps[idx++] = timestamp::ToJsValue(itemFile.item.timestamp, env);
+            });
         }
 
         return timestamps;
@@ -137,7 +626,7 @@ namespace nbs {
     Napi::Value Decoder::GetAvailableTypes(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        auto availableTypes = this->index.getTypes();
+        auto availableTypes = this->files->index.getTypes();
 
         auto jsTypes = Napi::Array::New(env, availableTypes.size());
 
@@ -153,6 +642,86 @@ namespace nbs {
         return jsTypes;
     }
 
+    Napi::Value Decoder::GetDensity(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        TypeSubtype typeSubtype;
+        try {
+            typeSubtype = this->TypeSubtypeFromJsValue(info[0], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, "invalid type for argument `typeSubtype`: " + std::string(ex.what()))
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        uint64_t start = 0;
+        try {
+            start = timestamp::FromJsValue(info[1], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, std::string("invalid type for argument `start`: ") + ex.what())
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        uint64_t end = 0;
+        try {
+            end = timestamp::FromJsValue(info[2], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, std::string("invalid type for argument `end`: ") + ex.what())
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        double jsBuckets = info[3].IsNumber() ? info[3].As<Napi::Number>().DoubleValue() : 0;
+        if (!(jsBuckets >= 1) || jsBuckets != std::floor(jsBuckets)) {
+            Napi::TypeError::New(env, "invalid argument `buckets`: expected positive integer")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // Use the widest power of two buckets no wider than the range split into the requested number of buckets, so
+        // the buckets line up with the density pyramid. That gives from about `buckets` to 2 * `buckets` buckets.
+        std::vector<DensityPyramid::Bucket> buckets;
+        unsigned shift = 0;
+        if (start <= end) {
+            const double width = std::max(1.0, std::floor(double(end - start) / jsBuckets));
+            while (shift < 63 && std::ldexp(1.0, int(shift) + 1) <= width) {
+                shift++;
+            }
+
+            TypeId id = this->files->index.getTypeId(typeSubtype);
+            if (id != NO_TYPE_ID) {
+                buckets = this->files->index.getDensity(id, start, end, shift);
+            }
+            else {
+                buckets.resize(size_t((end >> shift) - (start >> shift) + 1));
+            }
+        }
+
+        auto counts = Napi::Float64Array::New(env, buckets.size());
+        auto bytes  = Napi::Float64Array::New(env, buckets.size());
+        auto mins   = Napi::BigUint64Array::New(env, buckets.size());
+        auto maxes  = Napi::BigUint64Array::New(env, buckets.size());
+        for (size_t i = 0; i < buckets.size(); i++) {
+            counts[i] = double(buckets[i].count);
+            bytes[i]  = double(buckets[i].bytes);
+            mins[i]   = buckets[i].min;
+            maxes[i]  = buckets[i].max;
+        }
+
+        auto density = Napi::Object::New(env);
+        density.Set("start", timestamp::ToJsValue(buckets.empty() ? start : (start >> shift) << shift, env));
+        density.Set("width", Napi::Number::New(env, std::ldexp(1.0, int(shift))));
+        density.Set("counts", counts);
+        density.Set("bytes", bytes);
+        density.Set("min", mins);
+        density.Set("max", maxes);
+        return density;
+    }
+
     Napi::Value Decoder::GetTimestampRange(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -161,7 +730,7 @@ namespace nbs {
         if (info.Length() > 0) {
             try {
                 auto typeSubtype = this->TypeSubtypeFromJsValue(info[0], env);
-                range            = this->index.getTimestampRange(typeSubtype);
+                range            = this->files->index.getTimestampRange(typeSubtype);
             }
             catch (const std::exception& ex) {
                 Napi::TypeError::New(env, "invalid type for argument `typeSubtype`: " + std::string(ex.what()))
@@ -170,7 +739,7 @@ namespace nbs {
             }
         }
         else {
-            range = this->index.getTimestampRange();
+            range = this->files->index.getTimestampRange();
         }
 
         auto jsRange = Napi::Array::New(env, 2);
@@ -216,8 +785,11 @@ namespace nbs {
                 }
             }
         }
+        else if (IsTypeIds(info[1])) {
+            types = this->TypesFromJsIds(info[1]);
+        }
         else if (info[1].IsUndefined()) {
-            types = this->index.getTypes();
+            types = this->files->index.getTypes();
         }
 
         // Single type
@@ -246,7 +818,7 @@ namespace nbs {
         }
 
         // Sort and step(+-) index to find the new timestamp.
-        auto index_timestamp = this->index.nextTimestamp(timestamp, types, steps);
+        auto index_timestamp = this->files->index.nextTimestamp(timestamp, types, steps);
 
         // Convert timestamp back to Napi format and return.
         auto new_timestamp = timestamp::ToJsValue(index_timestamp, env).As<Napi::Number>();
@@ -256,21 +828,207 @@ namespace nbs {
     Napi::Value Decoder::GetPackets(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
-        uint64_t timestamp = 0;
-
-        try {
-            timestamp = timestamp::FromJsValue(info[0], env);
-        }
-        catch (const std::exception& ex) {
-            Napi::TypeError::New(env, std::string("invalid type for argument `timestamp`: ") + ex.what())
-                .ThrowAsJavaScriptException();
+        PacketsQuery query;
+        if (!this->ParsePacketsQuery(info, query)) {
             return env.Undefined();
         }
 
-        std::vector<TypeSubtype> types;
+        auto items     = this->files->GetMatchingItems(query.timestamp, query.types);
+        auto jsPackets = Napi::Array::New(env, items.size());
 
-        if (info[1].IsArray()) {
-            auto argTypes = info[1].As<Napi::Array>();
+        for (size_t i = 0; i < items.size(); i++) {
+            jsPackets[i] = this->ReadJsPacket(items[i], env);
+        }
+
+        return jsPackets;
+    }
+
+    Napi::Value Decoder::GetPacketsAt(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::vector<uint64_t> timestamps;
+        if (info[0].IsTypedArray() && info[0].As<Napi::TypedArray>().TypedArrayType() == napi_biguint64_array) {
+            auto jsTimestamps = info[0].As<Napi::BigUint64Array>();
+            timestamps.assign(jsTimestamps.Data(), jsTimestamps.Data() + jsTimestamps.ElementLength());
+        }
+        else if (info[0].IsArray()) {
+            auto jsTimestamps = info[0].As<Napi::Array>();
+            timestamps.reserve(jsTimestamps.Length());
+
+            for (std::size_t i = 0; i < jsTimestamps.Length(); i++) {
+                try {
+                    timestamps.push_back(timestamp::FromJsValue(jsTimestamps.Get(i), env));
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, "invalid item type in `timestamps` array: " + std::string(ex.what()))
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+        }
+        else {
+            Napi::TypeError::New(env, "invalid type for argument `timestamps`: expected array or BigUint64Array")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // The id of each type asked for, or NO_TYPE_ID for types that aren't in the index
+        std::vector<TypeId> ids;
+        std::vector<TypeSubtype> types;
+        if (info[1].IsArray()) {
+            auto argTypes = info[1].As<Napi::Array>();
+
+            for (std::size_t i = 0; i < argTypes.Length(); i++) {
+                try {
+                    types.push_back(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+        }
+        else if (IsTypeIds(info[1])) {
+            // Keep a column for every id, as for an array of types, so ids of types that aren't in the index don't
+            // move the columns after them
+            auto jsIds = info[1].As<Napi::Uint32Array>();
+            auto count = this->files->index.getTypeCount();
+            for (size_t i = 0; i < jsIds.ElementLength(); i++) {
+                ids.push_back(jsIds[i] < count ? TypeId(jsIds[i]) : NO_TYPE_ID);
+            }
+        }
+        else if (info[1].IsUndefined()) {
+            types = this->files->index.getTypes();
+        }
+        else {
+            Napi::TypeError::New(env, "invalid type for argument `types`: expected array or undefined")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // Visit the timestamps in order, so each type's position only ever moves forwards from the last one
+        std::vector<size_t> order(timestamps.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](const size_t& a, const size_t& b) {
+            return timestamps[a] < timestamps[b];
+        });
+
+        for (auto& type : types) {
+            ids.push_back(this->files->index.getTypeId(type));
+        }
+
+        std::vector<TypeId> foundIds;
+        std::copy_if(ids.begin(), ids.end(), std::back_inserter(foundIds), [](const TypeId& id) {
+            return id != NO_TYPE_ID;
+        });
+        auto columns = this->files->index.getColumnsForIds(foundIds);
+
+        // Nearby timestamps often have the same packet of a type, so each packet is only read once and the result
+        // says which packet each type has at each timestamp
+        constexpr uint32_t NO_PACKET = 0xFFFFFFFF;
+        auto jsIndices               = Napi::Uint32Array::New(env, timestamps.size() * ids.size());
+        auto jsPackets               = Napi::Array::New(env);
+        uint32_t packetCount         = 0;
+
+        size_t found = 0;
+        for (size_t j = 0; j < ids.size(); j++) {
+            const TypeColumns* type = ids[j] != NO_TYPE_ID ? columns[found++] : nullptr;
+
+            size_t position     = 0;
+            size_t lastPosition = 0;
+            uint32_t lastPacket = NO_PACKET;
+            for (auto& i : order) {
+                if (type != nullptr) {
+                    position = nbs::TypeCursor::gallop(*type, position, timestamps[i]);
+                }
+
+                if (position == 0) {
+                    jsIndices[i * ids.size() + j] = NO_PACKET;
+                    continue;
+                }
+
+                if (position != lastPosition) {
+                    lastPosition          = position;
+                    lastPacket            = packetCount++;
+                    jsPackets[lastPacket] = this->ReadJsPacket(type->item(position - 1), env);
+                }
+                jsIndices[i * ids.size() + j] = lastPacket;
+            }
+        }
+
+        auto result = Napi::Object::New(env);
+        result.Set("packets", jsPackets);
+        result.Set("indices", jsIndices);
+        return result;
+    }
+
+    Napi::Value Decoder::GetPacketsAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        PacketsQuery query;
+        if (!this->ParsePacketsQuery(info, query)) {
+            return env.Undefined();
+        }
+
+        auto signal = env.Undefined();
+        if (!info[2].IsUndefined()) {
+            if (!info[2].IsObject()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            signal = info[2].As<Napi::Object>().Get("signal");
+        }
+
+        if (!AsyncTask::IsSignal(signal)) {
+            Napi::TypeError::New(env, "invalid option `signal`: expected AbortSignal").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // The work holds the files it reads from, so it can carry on if the decoder is closed
+        auto files   = this->files;
+        auto packets = std::make_shared<std::vector<Packet>>();
+
+        return AsyncTask::Run(
+            env,
+            signal,
+            [files, query, packets](const std::atomic<bool>& aborted) {
+                std::shared_lock<SharedMutex> lock(files->mutex);
+                auto items = files->GetMatchingItems(query.timestamp, query.types);
+                files->WillNeed(items, 64 * 1024);
+
+                packets->reserve(items.size());
+                for (auto& item : items) {
+                    if (aborted) {
+                        throw AbortedError();
+                    }
+                    packets->push_back(files->Read(item));
+                    LoadPayload(packets->back());
+                }
+            },
+            [packets](const Napi::Env& env) -> Napi::Value {
+                auto jsPackets = Napi::Array::New(env, packets->size());
+                for (size_t i = 0; i < packets->size(); i++) {
+                    jsPackets[i] = Packet::ToJsValue((*packets)[i], env);
+                }
+                return jsPackets;
+            });
+    }
+
+    bool Decoder::ParsePacketsQuery(const Napi::CallbackInfo& info, PacketsQuery& query) {
+        Napi::Env env = info.Env();
+
+        try {
+            query.timestamp = timestamp::FromJsValue(info[0], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, std::string("invalid type for argument `timestamp`: ") + ex.what())
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (info[1].IsArray()) {
+            auto argTypes = info[1].As<Napi::Array>();
 
             // Get the types and subtypes
             for (std::size_t i = 0; i < argTypes.Length(); i++) {
@@ -278,34 +1036,258 @@ namespace nbs {
 
                 try {
                     auto typeSubtype = this->TypeSubtypeFromJsValue(item, env);
-                    types.push_back(typeSubtype);
+                    query.types.push_back(typeSubtype);
                 }
                 catch (const std::exception& ex) {
                     Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
                         .ThrowAsJavaScriptException();
-                    return env.Undefined();
+                    return false;
                 }
             }
         }
+        else if (IsTypeIds(info[1])) {
+            query.types = this->TypesFromJsIds(info[1]);
+        }
         else if (info[1].IsUndefined()) {
-            types = this->index.getTypes();
+            query.types = this->files->index.getTypes();
         }
         else {
             Napi::TypeError::New(env, "invalid type for argument `types`: expected array or undefined")
                 .ThrowAsJavaScriptException();
+            return false;
+        }
+
+        return true;
+    }
+
+    Napi::Value Decoder::GetPacketsInRange(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        RangeQuery query;
+        if (!this->ParseRangeQuery(info, query)) {
             return env.Undefined();
         }
 
-        auto packets   = this->GetMatchingPackets(timestamp, types);
-        auto jsPackets = Napi::Array::New(env, packets.size());
+        auto items = this->files->index.getItemsInRange(query.start, query.end, query.types, query.offset, query.limit);
+        auto jsPackets = Napi::Array::New(env, items.size());
 
-        for (size_t i = 0; i < packets.size(); i++) {
-            jsPackets[i] = Packet::ToJsValue(packets[i], env);
+        for (size_t i = 0; i < items.size(); i++) {
+            jsPackets[i] = this->ReadJsPacket(items[i], env);
         }
 
         return jsPackets;
     }
 
+    Napi::Value Decoder::GetPacketColumns(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        RangeQuery query;
+        if (!this->ParseRangeQuery(info, query)) {
+            return env.Undefined();
+        }
+
+        auto& index = this->files->index;
+        auto items  = index.getItemsInRange(query.start, query.end, query.types, query.offset, query.limit);
+
+        // Find where each payload is, so they can all be copied into one Buffer of the right size
+        std::vector<Packet> packets;
+        packets.reserve(items.size());
+        uint64_t payloadBytes = 0;
+        for (auto& item : items) {
+            packets.push_back(this->files->Read(item));
+            payloadBytes += packets.back().length;
+        }
+
+        if (payloadBytes > (std::numeric_limits<uint32_t>::max)()) {
+            Napi::RangeError::New(env, "the payloads are too large for one Buffer: read fewer packets with `limit`")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        auto payloads   = Napi::Buffer<uint8_t>::New(env, size_t(payloadBytes));
+        auto timestamps = Napi::BigUint64Array::New(env, packets.size());
+        auto typeIds    = Napi::Uint32Array::New(env, packets.size());
+        auto subtypes   = Napi::Uint32Array::New(env, packets.size());
+        auto offsets    = Napi::Uint32Array::New(env, packets.size());
+        auto lengths    = Napi::Uint32Array::New(env, packets.size());
+
+        // Packets of the same type tend to come in runs, so the type id is only looked up when the type changes
+        TypeSubtype lastType{0, 0};
+        TypeId lastId   = NO_TYPE_ID;
+        uint32_t offset = 0;
+        for (size_t i = 0; i < packets.size(); i++) {
+            auto& packet = packets[i];
+
+            TypeSubtype type{packet.type, packet.subtype};
+            if (lastId == NO_TYPE_ID || type != lastType) {
+                lastType = type;
+                lastId   = index.getTypeId(type);
+            }
+
+            if (packet.length > 0) {
+                std::memcpy(payloads.Data() + offset, packet.payload, packet.length);
+            }
+
+            timestamps[i] = packet.timestamp;
+            typeIds[i]    = uint32_t(lastId);
+            subtypes[i]   = packet.subtype;
+            offsets[i]    = offset;
+            lengths[i]    = packet.length;
+            offset += packet.length;
+        }
+
+        // The types in type id order, so `types[typeIds[i]]` is the type of packet i
+        auto types = Napi::Array::New(env, index.getTypeCount());
+        for (size_t id = 0; id < index.getTypeCount(); id++) {
+            auto& type  = index.getType(TypeId(id));
+            auto jsType = Napi::Object::New(env);
+            jsType.Set("type", hash::ToJsValue(type.type, env));
+            jsType.Set("subtype", Napi::Number::New(env, type.subtype));
+            types[id] = jsType;
+        }
+
+        auto columns = Napi::Object::New(env);
+        columns.Set("types", types);
+        columns.Set("timestamps", timestamps);
+        columns.Set("typeIds", typeIds);
+        columns.Set("subtypes", subtypes);
+        columns.Set("offsets", offsets);
+        columns.Set("lengths", lengths);
+        columns.Set("payloads", payloads);
+        return columns;
+    }
+
+    Napi::Value Decoder::GetPacketsInRangeAsync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        RangeQuery query;
+        if (!this->ParseRangeQuery(info, query)) {
+            return env.Undefined();
+        }
+
+        auto signal = info[3].IsObject() ? info[3].As<Napi::Object>().Get("signal") : env.Undefined();
+        if (!AsyncTask::IsSignal(signal)) {
+            Napi::TypeError::New(env, "invalid option `signal`: expected AbortSignal").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // The work holds the files it reads from, so it can carry on if the decoder is closed
+        auto files   = this->files;
+        auto packets = std::make_shared<std::vector<Packet>>();
+
+        return AsyncTask::Run(
+            env,
+            signal,
+            [files, query, packets](const std::atomic<bool>& aborted) {
+                std::shared_lock<SharedMutex> lock(files->mutex);
+                auto items =
+                    files->index.getItemsInRange(query.start, query.end, query.types, query.offset, query.limit);
+
+                // Start reading all the packets from disk before copying any of them. Packets that are close together
+                // are advised as one range, since the kernel reads ahead around them anyway.
+                files->WillNeed(items, 64 * 1024);
+
+                packets->reserve(items.size());
+                for (auto& item : items) {
+                    if (aborted) {
+                        throw AbortedError();
+                    }
+                    packets->push_back(files->Read(item));
+                    LoadPayload(packets->back());
+                }
+            },
+            [packets](const Napi::Env& env) -> Napi::Value {
+                auto jsPackets = Napi::Array::New(env, packets->size());
+                for (size_t i = 0; i < packets->size(); i++) {
+                    jsPackets[i] = Packet::ToJsValue((*packets)[i], env);
+                }
+                return jsPackets;
+            });
+    }
+
+    bool Decoder::ParseRangeQuery(const Napi::CallbackInfo& info, RangeQuery& query) {
+        Napi::Env env = info.Env();
+
+        try {
+            query.start = timestamp::FromJsValue(info[0], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, std::string("invalid type for argument `start`: ") + ex.what())
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+
+        try {
+            query.end = timestamp::FromJsValue(info[1], env);
+        }
+        catch (const std::exception& ex) {
+            Napi::TypeError::New(env, std::string("invalid type for argument `end`: ") + ex.what())
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (info[2].IsArray()) {
+            auto argTypes = info[2].As<Napi::Array>();
+
+            for (std::size_t i = 0; i < argTypes.Length(); i++) {
+                try {
+                    query.types.push_back(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                        .ThrowAsJavaScriptException();
+                    return false;
+                }
+            }
+        }
+        else if (IsTypeIds(info[2])) {
+            query.types = this->TypesFromJsIds(info[2]);
+        }
+        else if (info[2].IsUndefined()) {
+            query.types = this->files->index.getTypes();
+        }
+        else {
+            Napi::TypeError::New(env, "invalid type for argument `types`: expected array or undefined")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (!info[3].IsUndefined()) {
+            if (!info[3].IsObject()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto options = info[3].As<Napi::Object>();
+
+            auto jsLimit = options.Get("limit");
+            if (jsLimit.IsNumber() && jsLimit.As<Napi::Number>().DoubleValue() >= 0) {
+                double value = jsLimit.As<Napi::Number>().DoubleValue();
+                query.limit  = value >= double(query.limit) ? query.limit : size_t(value);
+            }
+            else if (!jsLimit.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `limit`: expected non-negative number")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+
+            auto jsOffset = options.Get("offset");
+            if (jsOffset.IsNumber() && jsOffset.As<Napi::Number>().DoubleValue() >= 0) {
+                double value = jsOffset.As<Napi::Number>().DoubleValue();
+                query.offset = value >= double((std::numeric_limits<size_t>::max)())
+                                   ? (std::numeric_limits<size_t>::max)()
+                                   : size_t(value);
+            }
+            else if (!jsOffset.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `offset`: expected non-negative number")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     Napi::Value Decoder::GetPacketByIndex(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
@@ -334,63 +1316,59 @@ namespace nbs {
             return env.Undefined();
         }
 
-        auto typeIterator = this->index.getIteratorForType(typeSubtype);
+        auto columns = this->files->index.getColumnsForType(typeSubtype);
 
         // If the index is out of range return undefined
-        if (std::distance(typeIterator.first, typeIterator.second) <= index) {
+        if (columns == nullptr || int64_t(columns->size()) <= index) {
             return env.Undefined();
         }
 
-        auto packetLocation = std::next(typeIterator.first, index);
-        auto packet         = this->Read(*packetLocation);
-        return Packet::ToJsValue(packet, env);
+        return this->ReadJsPacket(columns->item(index), env);
     }
 
-    std::vector<Packet> Decoder::GetMatchingPackets(const uint64_t& timestamp, const std::vector<TypeSubtype>& types) {
-        std::vector<Packet> packets;
-
-        auto matchingIndexItems = this->index.getIteratorsForTypes(types);
-
-        for (auto& iteratorPair : matchingIndexItems) {
-            auto& begin = iteratorPair.first;
-            auto& end   = iteratorPair.second;
+    std::vector<IndexItemFile> DecoderFiles::GetMatchingItems(const uint64_t& timestamp,
+                                                              const std::vector<TypeSubtype>& types) const {
+        std::vector<IndexItemFile> items;
 
-            IndexItemFile compValue;
-            compValue.item.timestamp = timestamp;
+        auto matchingIndexItems = this->index.getColumnsForTypes(types);
 
+        for (auto& columns : matchingIndexItems) {
             // Find the first item with a timestamp strictly greater than timestamp
-            auto found = std::upper_bound(begin, end, compValue, [](const IndexItemFile& a, const IndexItemFile& b) {
-                return a.item.timestamp < b.item.timestamp;
-            });
+            auto found = columns->upperBound(timestamp);
 
-            if (found == begin) {
-                // No packet found for this type at the requested timestamp, insert an empty packet
-                Packet emptyPacket;
-                emptyPacket.timestamp = timestamp;
-                emptyPacket.type      = iteratorPair.first->item.type;
-                emptyPacket.subtype   = iteratorPair.first->item.subtype;
-                emptyPacket.payload   = nullptr;
-                emptyPacket.length    = 0;
+            if (found == 0) {
+                // No packet found for this type at the requested timestamp, insert an item for an empty packet
+                IndexItemFile empty{};
+                empty.item.timestamp = timestamp;
+                empty.item.type      = columns->type.type;
+                empty.item.subtype   = columns->type.subtype;
 
-                packets.push_back(emptyPacket);
+                items.push_back(empty);
             }
             else {
-                Packet packet = this->Read(*std::prev(found, 1));
-                packets.push_back(packet);
+                items.push_back(columns->item(found - 1));
             }
         }
 
-        return packets;
+        return items;
     }
 
-    Packet Decoder::Read(const IndexItemFile& item) {
+    Packet DecoderFiles::Read(const IndexItemFile& item) const {
         Packet packet;
 
         packet.timestamp = item.item.timestamp;
         packet.type      = item.item.type;
         packet.subtype   = item.item.subtype;
 
-        uint8_t* packetOffset = &this->memoryMaps[item.fileno][item.item.offset];
+        // An item with no length is for an empty packet
+        if (item.item.length == 0) {
+            packet.payload = nullptr;
+            packet.length  = 0;
+            return packet;
+        }
+
+        auto& map             = this->memoryMaps[item.fileno];
+        uint8_t* packetOffset = const_cast<uint8_t*>(map->data()) + item.item.offset;
 
         constexpr int headerLength = 3                    // 3 is length of ☢ symbol
                                      + sizeof(uint32_t)   // packet length
@@ -400,9 +1378,112 @@ namespace nbs {
         packet.payload = packetOffset + headerLength;
         packet.length  = item.item.length - headerLength;
 
+        // The payload will point straight into the map, so the map has to outlive it
+        if (this->options.zeroCopy) {
+            packet.owner = map;
+        }
+
         return packet;
     }
 
+    std::shared_ptr<DecoderFiles::MemoryMap> DecoderFiles::Map(const std::string& path, std::error_code& error) const {
+        auto map = std::make_shared<MemoryMap>();
+        map->map(path, 0, mio::map_entire_file, error);
+        if (error || map->empty()) {
+            return map;
+        }
+
+        auto data = const_cast<uint8_t*>(map->data());
+        auto size = map->size();
+
+#if !defined(_WIN32)
+        if (this->options.accessPattern != AccessPattern::NORMAL) {
+            posix_madvise(data,
+                          size,
+                          this->options.accessPattern == AccessPattern::SEQUENTIAL ? POSIX_MADV_SEQUENTIAL
+                                                                                  : POSIX_MADV_RANDOM);
+        }
+
+    #if defined(MADV_HUGEPAGE)
+        // Only some Linux file systems can give file maps huge pages, so this may do nothing
+        if (this->options.hugePages) {
+            madvise(data, size, MADV_HUGEPAGE);
+        }
+    #endif
+
+        if (uint64_t(size) <= this->options.populate) {
+            posix_madvise(data, size, POSIX_MADV_WILLNEED);
+        }
+#endif
+
+        // mio can't map with MAP_POPULATE, so populate the map by reading a byte from each page instead
+        if (uint64_t(size) <= this->options.populate) {
+            TouchPages(data, size);
+        }
+
+        return map;
+    }
+
+    void DecoderFiles::WillNeed(const std::vector<IndexItemFile>& items, const uint64_t& maxGap) const {
+#if !defined(_WIN32)
+        struct Range {
+            int fileno;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        std::vector<Range> ranges;
+        ranges.reserve(items.size());
+        for (auto& itemFile : items) {
+            ranges.push_back({itemFile.fileno, itemFile.item.offset, itemFile.item.offset + itemFile.item.length});
+        }
+        std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+            return a.fileno != b.fileno ? a.fileno < b.fileno : a.begin < b.begin;
+        });
+
+        static const uint64_t pageSize = uint64_t(sysconf(_SC_PAGESIZE));
+
+        for (size_t i = 0; i < ranges.size();) {
+            Range merged = ranges[i++];
+            while (i < ranges.size() && ranges[i].fileno == merged.fileno && ranges[i].begin <= merged.end + maxGap) {
+                merged.end = std::max(merged.end, ranges[i++].end);
+            }
+
+            auto& map = this->memoryMaps[merged.fileno];
+            if (map->empty()) {
+                continue;
+            }
+
+            // The map starts at the start of the file, so it is page aligned
+            const uint64_t begin = merged.begin - merged.begin % pageSize;
+            const uint64_t end   = std::min<uint64_t>(merged.end, map->size());
+            if (begin < end) {
+                posix_madvise(const_cast<uint8_t*>(map->data()) + begin, size_t(end - begin), POSIX_MADV_WILLNEED);
+            }
+        }
+#else
+        // PrefetchVirtualMemory() would do this, but it needs Windows 8, so the pages are only read as they are touched
+        (void) items;
+        (void) maxGap;
+#endif
+    }
+
+    Napi::Value Decoder::ReadJsPacket(const IndexItemFile& item, const Napi::Env& env) {
+        // Empty packets aren't in the files, and are cheap to make
+        if (!this->packetCache->enabled() || item.item.length == 0) {
+            return Packet::ToJsValue(this->files->Read(item), env);
+        }
+
+        auto cached = this->packetCache->get(item);
+        if (!cached.IsEmpty()) {
+            return cached;
+        }
+
+        auto jsPacket = Packet::ToJsValue(this->files->Read(item), env);
+        this->packetCache->put(item, jsPacket);
+        return jsPacket;
+    }
+
     TypeSubtype Decoder::TypeSubtypeFromJsValue(const Napi::Value& jsTypeSubtype, const Napi::Env& env) {
         if (!jsTypeSubtype.IsObject()) {
             throw std::runtime_error("expected object");
@@ -435,10 +1516,523 @@ namespace nbs {
         return {type, subtype};
     }
 
+    Napi::Value Decoder::GetSearchStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        // Report the types as they are, so asking for the stats doesn't load the types of a lazy index
+        auto types   = this->files->index.getTypes();
+        auto jsStats = Napi::Array::New(env, types.size());
+
+        for (size_t i = 0; i < types.size(); i++) {
+            auto& columns = this->files->index.peekColumns(this->files->index.getTypeId(types[i]));
+
+            auto strategy          = columns.strategy();
+            const char* jsStrategy = strategy == SearchStrategy::COMPACT         ? "compact"
+                                     : strategy == SearchStrategy::INTERPOLATION ? "interpolation"
+                                     : strategy == SearchStrategy::TREE          ? "tree"
+                                                                                 : "binary";
+
+            auto jsTypeStats = Napi::Object::New(env);
+            jsTypeStats.Set("type", hash::ToJsValue(types[i].type, env));
+            jsTypeStats.Set("subtype", Napi::Number::New(env, types[i].subtype));
+            jsTypeStats.Set("strategy", Napi::String::New(env, jsStrategy));
+            jsTypeStats.Set("searches", Napi::Number::New(env, double(columns.stats.searches.load())));
+            jsTypeStats.Set("probes", Napi::Number::New(env, double(columns.stats.probes.load())));
+
+            jsStats[i] = jsTypeStats;
+        }
+
+        return jsStats;
+    }
+
+    Napi::Value Decoder::GetCacheStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        auto jsStats = Napi::Object::New(env);
+        jsStats.Set("hits", Napi::Number::New(env, double(this->packetCache->hits)));
+        jsStats.Set("misses", Napi::Number::New(env, double(this->packetCache->misses)));
+        jsStats.Set("packets", Napi::Number::New(env, double(this->packetCache->size())));
+        jsStats.Set("bytes", Napi::Number::New(env, double(this->packetCache->bytes())));
+        jsStats.Set("budget", Napi::Number::New(env, double(this->packetCache->budget)));
+
+        return jsStats;
+    }
+
+    void Decoder::Prefetch(const Napi::CallbackInfo& info) {
+        RangeQuery query;
+        if (!this->ParseRangeQuery(info, query)) {
+            return;
+        }
+
+        // Only advise the bytes of the packets themselves, so prefetching sparse types doesn't read the whole file
+        auto items = this->files->index.getItemsInRange(query.start, query.end, query.types, query.offset, query.limit);
+        this->files->WillNeed(items, 0);
+    }
+
+    void Decoder::Evict(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::vector<TypeSubtype> types;
+
+        if (info[0].IsArray()) {
+            auto argTypes = info[0].As<Napi::Array>();
+
+            for (std::size_t i = 0; i < argTypes.Length(); i++) {
+                try {
+                    types.push_back(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                        .ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+        }
+        else if (IsTypeIds(info[0])) {
+            types = this->TypesFromJsIds(info[0]);
+        }
+        else if (info[0].IsUndefined()) {
+            types = this->files->index.getTypes();
+        }
+        else {
+            Napi::TypeError::New(env, "invalid type for argument `types`: expected array or undefined")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+
+        // Decoders on other threads may be reading the items without locking
+        if (this->files->sharedId != 0) {
+            Napi::Error::New(env, "evict() is not supported for shared decoders").ThrowAsJavaScriptException();
+            return;
+        }
+
+        std::vector<TypeId> ids;
+        for (auto& type : types) {
+            TypeId id = this->files->index.getTypeId(type);
+            if (id != NO_TYPE_ID) {
+                ids.push_back(id);
+            }
+        }
+
+        // Wait for any async reads to finish before releasing the items they may be reading
+        std::unique_lock<SharedMutex> lock(this->files->mutex);
+        this->files->index.evict(ids);
+    }
+
+    Napi::Value Decoder::Cursor(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::vector<bool> types;
+        bool seek          = false;
+        uint64_t timestamp = 0;
+
+        if (!info[0].IsUndefined()) {
+            if (!info[0].IsObject()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            auto options = info[0].As<Napi::Object>();
+
+            auto jsTypes = options.Get("types");
+            if (IsTypeIds(jsTypes)) {
+                types.resize(this->files->index.getTypeCount(), false);
+                for (auto& type : this->TypesFromJsIds(jsTypes)) {
+                    types[this->files->index.getTypeId(type)] = true;
+                }
+
+                // As for an array of types, an empty filter would match everything
+                if (std::find(types.begin(), types.end(), true) == types.end()) {
+                    types.push_back(false);
+                }
+            }
+            else if (jsTypes.IsArray()) {
+                auto argTypes = jsTypes.As<Napi::Array>();
+                types.resize(this->files->index.getTypeCount(), false);
+
+                for (std::size_t i = 0; i < argTypes.Length(); i++) {
+                    try {
+                        TypeId id = this->files->index.getTypeId(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+                        if (id != NO_TYPE_ID) {
+                            types[id] = true;
+                        }
+                    }
+                    catch (const std::exception& ex) {
+                        Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                            .ThrowAsJavaScriptException();
+                        return env.Undefined();
+                    }
+                }
+
+                // Types that aren't in the index can't match anything, but an empty filter would match everything
+                if (std::find(types.begin(), types.end(), true) == types.end()) {
+                    types.push_back(false);
+                }
+            }
+            else if (!jsTypes.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `types`: expected array").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            auto jsTimestamp = options.Get("timestamp");
+            if (!jsTimestamp.IsUndefined()) {
+                try {
+                    timestamp = timestamp::FromJsValue(jsTimestamp, env);
+                    seek      = true;
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, std::string("invalid option `timestamp`: ") + ex.what())
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+        }
+
+        // Cursors over only some of the types step through the types' own columns, rather than skipping over the
+        // packets of every other type in the timeline
+        std::vector<TypeId> ids;
+        for (size_t id = 0; id < types.size(); id++) {
+            if (types[id]) {
+                ids.push_back(TypeId(id));
+            }
+        }
+        const bool merge = !types.empty() && ids.size() < this->files->index.getTypeCount();
+
+        // The cursor's functions share its state, which keeps the decoder alive for as long as any of them are
+        struct CursorState {
+            Napi::ObjectReference decoderRef;
+            Decoder* decoder;
+            bool merge;
+            TimelineCursor cursor;
+            MergeCursor mergeCursor;
+
+            /// The types of a merge cursor, in the same order as its type ids. These are looked up in the decoder's
+            /// index each time, since closing the decoder swaps in an index without them.
+            std::vector<TypeSubtype> types;
+
+            /// Stands in for the columns of types that aren't in the index
+            TypeColumns missing;
+
+            /// The timeline, or the columns of each of a merge cursor's types, from the version of the decoder's index
+            /// in `version`. These are only looked up again after items are added or evicted or the decoder is closed,
+            /// so steps don't have to.
+            uint64_t version         = 0;
+            const Timeline* timeline = nullptr;
+            std::vector<const TypeColumns*> columns;
+
+            /// Look up the timeline or columns again if the decoder's index has changed since they were looked up
+            void refresh() {
+                auto& index = this->decoder->files->index;
+                if (this->version == index.getVersion()) {
+                    return;
+                }
+
+                this->version = index.getVersion();
+                if (this->merge) {
+                    this->columns = this->getColumns();
+                }
+                else {
+                    this->timeline = &index.getTimeline();
+                }
+            }
+
+            /// Get the columns of each of a merge cursor's types, with empty columns for types that aren't in the index
+            std::vector<const TypeColumns*> getColumns() const {
+                auto& index = this->decoder->files->index;
+
+                std::vector<TypeId> found;
+                for (auto& type : this->types) {
+                    TypeId id = index.getTypeId(type);
+                    if (id != NO_TYPE_ID) {
+                        found.push_back(id);
+                    }
+                }
+
+                // Look up the found types together, so a lazy index only reads its files once
+                auto foundColumns = index.getColumnsForIds(found);
+
+                std::vector<const TypeColumns*> columns;
+                columns.reserve(this->types.size());
+                for (size_t i = 0, next = 0; i < this->types.size(); i++) {
+                    const bool isFound = next < found.size() && index.getType(found[next]) == this->types[i];
+                    columns.push_back(isFound ? foundColumns[next++] : &this->missing);
+                }
+
+                return columns;
+            }
+
+            void seek(const uint64_t& timestamp) {
+                this->refresh();
+                if (this->merge) {
+                    this->mergeCursor.seek(this->columns, timestamp);
+                }
+                else {
+                    this->cursor.seek(*this->timeline, timestamp);
+                }
+            }
+        };
+
+        auto state        = std::make_shared<CursorState>();
+        state->decoderRef = Napi::Persistent(this->Value());
+        state->decoder    = this;
+        state->merge      = merge;
+        for (auto& id : ids) {
+            state->types.push_back(this->files->index.getType(id));
+        }
+        state->mergeCursor = MergeCursor(std::move(ids));
+
+        if (seek) {
+            state->seek(timestamp);
+        }
+
+        auto step = [state](const Napi::CallbackInfo& info, bool forwards) -> Napi::Value {
+            Napi::Env env = info.Env();
+            auto& decoder = *state->decoder;
+
+            IndexItemFile item{};
+            bool found = false;
+            state->refresh();
+            if (state->merge) {
+                auto& columns = state->columns;
+
+                found = forwards ? state->mergeCursor.next(columns, item) : state->mergeCursor.prev(columns, item);
+            }
+            else {
+                auto& timeline = *state->timeline;
+
+                found = forwards ? state->cursor.next(timeline, item) : state->cursor.prev(timeline, item);
+            }
+            if (!found) {
+                return env.Undefined();
+            }
+
+            return decoder.ReadJsPacket(item, env);
+        };
+
+        auto jsCursor = Napi::Object::New(env);
+
+        jsCursor.Set("next", Napi::Function::New(env, [step](const Napi::CallbackInfo& info) {
+                         return step(info, true);
+                     }));
+        jsCursor.Set("prev", Napi::Function::New(env, [step](const Napi::CallbackInfo& info) {
+                         return step(info, false);
+                     }));
+        jsCursor.Set("seek", Napi::Function::New(env, [state](const Napi::CallbackInfo& info) -> Napi::Value {
+            Napi::Env env = info.Env();
+
+            uint64_t timestamp = 0;
+            try {
+                timestamp = timestamp::FromJsValue(info[0], env);
+            }
+            catch (const std::exception& ex) {
+                Napi::TypeError::New(env, std::string("invalid type for argument `timestamp`: ") + ex.what())
+                    .ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            state->seek(timestamp);
+            return env.Undefined();
+        }));
+
+        return jsCursor;
+    }
+
+    Napi::Value Decoder::TypeCursor(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::vector<TypeSubtype> types;
+        if (info[0].IsArray()) {
+            auto argTypes = info[0].As<Napi::Array>();
+
+            for (std::size_t i = 0; i < argTypes.Length(); i++) {
+                try {
+                    types.push_back(this->TypeSubtypeFromJsValue(argTypes.Get(i), env));
+                }
+                catch (const std::exception& ex) {
+                    Napi::TypeError::New(env, "invalid item type in `types` array: " + std::string(ex.what()))
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+        }
+        else if (IsTypeIds(info[0])) {
+            types = this->TypesFromJsIds(info[0]);
+        }
+        else if (info[0].IsUndefined()) {
+            types = this->files->index.getTypes();
+        }
+        else {
+            Napi::TypeError::New(env, "invalid type for argument `types`: expected array or undefined")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // The seek function keeps the decoder alive for as long as it is
+        struct TypeCursorState {
+            Napi::ObjectReference decoderRef;
+            Decoder* decoder;
+            nbs::TypeCursor cursor;
+        };
+
+        auto state        = std::make_shared<TypeCursorState>();
+        state->decoderRef = Napi::Persistent(this->Value());
+        state->decoder    = this;
+        state->cursor     = nbs::TypeCursor(std::move(types));
+
+        auto jsCursor = Napi::Object::New(env);
+
+        jsCursor.Set("seek", Napi::Function::New(env, [state](const Napi::CallbackInfo& info) -> Napi::Value {
+            Napi::Env env = info.Env();
+
+            uint64_t timestamp = 0;
+            try {
+                timestamp = timestamp::FromJsValue(info[0], env);
+            }
+            catch (const std::exception& ex) {
+                Napi::TypeError::New(env, std::string("invalid type for argument `timestamp`: ") + ex.what())
+                    .ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            auto& decoder  = *state->decoder;
+            auto items     = state->cursor.seek(decoder.files->index, timestamp);
+            auto jsPackets = Napi::Array::New(env, items.size());
+
+            for (size_t i = 0; i < items.size(); i++) {
+                jsPackets[i] = decoder.ReadJsPacket(items[i], env);
+            }
+
+            return jsPackets;
+        }));
+
+        return jsCursor;
+    }
+
+    void Decoder::Follow(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (!info[0].IsFunction()) {
+            Napi::TypeError::New(env, "invalid argument `callback`: expected function").ThrowAsJavaScriptException();
+            return;
+        }
+
+        auto interval = std::chrono::milliseconds(100);
+        if (!info[1].IsUndefined()) {
+            if (!info[1].IsObject()) {
+                Napi::TypeError::New(env, "invalid argument `options`: expected object").ThrowAsJavaScriptException();
+                return;
+            }
+
+            auto jsInterval = info[1].As<Napi::Object>().Get("interval");
+            if (jsInterval.IsNumber() && jsInterval.As<Napi::Number>().DoubleValue() > 0) {
+                interval = std::chrono::milliseconds(std::max<int64_t>(1, jsInterval.As<Napi::Number>().Int64Value()));
+            }
+            else if (!jsInterval.IsUndefined()) {
+                Napi::TypeError::New(env, "invalid option `interval`: expected positive number")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+        }
+
+        if (this->files->index.isLazy()) {
+            Napi::Error::New(env, "follow() is not supported for decoders opened with the `lazy` option")
+                .ThrowAsJavaScriptException();
+            return;
+        }
+
+        if (this->files->sharedId != 0) {
+            Napi::Error::New(env, "follow() is not supported for shared decoders").ThrowAsJavaScriptException();
+            return;
+        }
+
+        // Stop following with any previous callback first
+        this->follower.reset();
+
+        // Start reading each file just after the last packet that is already in the index
+        this->follower.reset(new Follower(env,
+                                          info[0].As<Napi::Function>(),
+                                          this->files->paths,
+                                          this->files->index.getFileEnds(this->files->paths.size()),
+                                          interval,
+                                          [this](const Napi::Env& env, const Follower::Batch& batch) {
+                                              return this->ApplyFollowBatch(env, batch);
+                                          }));
+    }
+
+    void Decoder::Unfollow(const Napi::CallbackInfo& /*info*/) {
+        this->follower.reset();
+    }
+
+    Napi::Value Decoder::ApplyFollowBatch(const Napi::Env& env, const Follower::Batch& batch) {
+        auto& files = *this->files;
+
+        // Find how much of each file the new packets need to be mapped
+        std::vector<uint64_t> ends(files.paths.size(), 0);
+        for (auto& itemFile : batch.items) {
+            auto& end = ends[itemFile.fileno];
+            end       = std::max(end, itemFile.item.offset + itemFile.item.length);
+        }
+
+        // Wait for any async reads to finish before changing the maps and index they read from
+        std::unique_lock<SharedMutex> lock(files.mutex);
+
+        // Remap the files that have grown past their mapping. If a file can't be remapped its new packets are
+        // dropped, since they couldn't be read.
+        std::vector<bool> readable(files.paths.size(), true);
+        for (size_t i = 0; i < files.paths.size(); i++) {
+            if (ends[i] > uint64_t(files.memoryMaps[i]->size())) {
+                std::error_code error;
+                auto map = files.Map(files.paths[i], error);
+
+                // Payloads from the old map may still be in use, so it is left to be unmapped when they are done
+                if (!error && uint64_t(map->size()) >= ends[i]) {
+                    files.memoryMaps[i] = std::move(map);
+                }
+                else {
+                    readable[i] = false;
+                }
+            }
+        }
+
+        std::vector<IndexItemFile> items;
+        uint64_t start = (std::numeric_limits<uint64_t>::max)();
+        uint64_t end   = 0;
+        for (auto& itemFile : batch.items) {
+            if (readable[itemFile.fileno]) {
+                items.push_back(itemFile);
+                start = std::min(start, itemFile.item.timestamp);
+                end   = std::max(end, itemFile.item.timestamp);
+            }
+        }
+
+        auto event = Napi::Object::New(env);
+        event.Set("packets", Napi::Number::New(env, double(items.size())));
+        event.Set("start", timestamp::ToJsValue(items.empty() ? 0 : start, env));
+        event.Set("end", timestamp::ToJsValue(end, env));
+
+        files.index.append(std::move(items));
+        return event;
+    }
+
     void Decoder::Close(const Napi::CallbackInfo& info) {
-        for (auto& map : memoryMaps) {
-            map.unmap();
+        // Stop following before the maps go away
+        this->follower.reset();
+
+        // Swap in files with no maps and an empty index, rather than changing the files in place, so async work that
+        // is still reading them can finish. Each map is unmapped once the last payload pointing into it (with the
+        // `zeroCopy` option) is collected, and the index is released too, which may be holding a memory mapped index
+        // cache open.
+        auto closed      = std::make_shared<DecoderFiles>();
+        closed->paths   = this->files->paths;
+        closed->options = this->files->options;
+        for (size_t i = 0; i < closed->paths.size(); i++) {
+            closed->memoryMaps.push_back(std::make_shared<DecoderFiles::MemoryMap>());
         }
+
+        this->files = std::move(closed);
+
+        // The cached packets may be keeping the old maps open
+        this->packetCache->clear();
     }
 
 }  // namespace nbs
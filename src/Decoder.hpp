@@ -1,21 +1,113 @@
 #ifndef NBS_DECODER_HPP
 #define NBS_DECODER_HPP
 
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <napi.h>
+#include <string>
 #include <vector>
 
+#include "Follower.hpp"
 #include "Index.hpp"
 #include "Packet.hpp"
+#include "PacketCache.hpp"
+#include "SharedMutex.hpp"
+#include "TypeCursor.hpp"
 #include "TypeSubtype.hpp"
 #include "third-party/mio/mmap.hpp"
 
 namespace nbs {
+
+    /// How the nbs files will be read, as a hint to the OS about what to read ahead and what to keep in memory
+    enum class AccessPattern { NORMAL, SEQUENTIAL, RANDOM };
+
+    /// Options for mapping and reading the nbs files
+    struct ReadOptions {
+        /// Return payloads as Buffers that point into the memory maps, rather than copies
+        bool zeroCopy = false;
+
+        /// How the files will be read
+        AccessPattern accessPattern = AccessPattern::NORMAL;
+
+        /// Files of at most this many bytes are read into memory as soon as they are mapped
+        uint64_t populate = 0;
+
+        /// Ask for the maps to be backed by transparent huge pages, where the OS supports it for files
+        bool hugePages = false;
+
+        /// The most bytes of JS packets to keep in the decoder's packet cache, or 0 for no cache
+        size_t packetCache = 0;
+    };
+
+    /**
+     * The index and memory maps of a decoder's nbs files.
+     *
+     * These are shared with any async work reading from them, which keeps them alive if the decoder is closed while
+     * the work is running. Async work reads them on other threads while holding `mutex` as a reader, so anything that
+     * changes them has to hold it as the writer.
+     *
+     * Once shared with share(), decoders on other JS threads read them without holding the mutex, so they must not be
+     * changed again.
+     */
+    struct DecoderFiles {
+        using MemoryMap = mio::basic_mmap_source<uint8_t>;
+
+        /// The paths of the nbs files
+        std::vector<std::string> paths;
+
+        /// Holds the index for the nbs files
+        Index index;
+
+        /// Memory maps for each nbs file in the index, in the same order as the paths. Shared with any payloads that
+        /// point into them.
+        std::vector<std::shared_ptr<MemoryMap>> memoryMaps;
+
+        /// How the files are mapped and read
+        ReadOptions options;
+
+        /// Held as a reader while reading from another thread, and as the writer while changing the index or maps
+        SharedMutex mutex;
+
+        /// The id of the handle the files were shared with, or 0 if they haven't been shared
+        std::atomic<uint64_t> sharedId{0};
+
+        /**
+         * Index and memory map the given nbs files
+         *
+         * @param paths    the paths of the nbs files
+         * @param options  the options for the index
+         * @param readOptions how to map and read the files
+         * @throws std::exception if a file can't be indexed or mapped
+         */
+        static std::shared_ptr<DecoderFiles> Open(const std::vector<std::string>& paths,
+                                                  const IndexOptions& options,
+                                                  const ReadOptions& readOptions);
+
+        /// Map the nbs file with the given path, and give the OS the hints from the read options. The map is empty if
+        /// the file is empty.
+        std::shared_ptr<MemoryMap> Map(const std::string& path, std::error_code& error) const;
+
+        /// Read the packet for the given index item, or make an empty packet for an item with a length of 0
+        Packet Read(const IndexItemFile& item) const;
+
+        /// Tell the OS that the packets of the given items will be read soon, so it can start reading them from disk
+        /// all at once rather than as each page is touched. Packets less than `maxGap` bytes apart are advised as one
+        /// range, along with the bytes between them.
+        void WillNeed(const std::vector<IndexItemFile>& items, const uint64_t& maxGap) const;
+
+        /// Get the index items of the packets at the given timestamp for the given types and subtypes. Types with no
+        /// packet at or before the timestamp get an item with a length of 0 and the given timestamp, for an empty
+        /// packet.
+        std::vector<IndexItemFile> GetMatchingItems(const uint64_t& timestamp,
+                                                    const std::vector<TypeSubtype>& types) const;
+    };
     class Decoder : public Napi::ObjectWrap<Decoder> {
     public:
         /// Initialize the Decoder class NAPI binding
         static Napi::Object Init(Napi::Env& env, Napi::Object& exports);
 
-        /// Constructor: takes a list of file paths from JS and constructs a Decoder
+        /// Constructor: takes a list of file paths and an optional options object from JS and constructs a Decoder
         Decoder(const Napi::CallbackInfo& info);
 
         /// Get a list of the available types in the nbs files of this decoder
@@ -25,6 +117,14 @@ namespace nbs {
         /// Get all the timestamps of a specified message type subtype from the index
         Napi::Value GetTypeIndex(const Napi::CallbackInfo& info);
 
+        /// Look up the dense ids of the given types, which other methods take in place of the types themselves
+        /// Returns a JS Uint32Array of type ids, with 0xFFFFFFFF for types that aren't in the nbs files
+        Napi::Value ResolveTypes(const Napi::CallbackInfo& info);
+
+        /// Summarise how the packets of a type are spread between two timestamps, in about the given number of buckets
+        /// Returns a JS object with the count, bytes, and first and last timestamps of each bucket as typed arrays
+        Napi::Value GetDensity(const Napi::CallbackInfo& info);
+
         /// Get a list of the available types in the nbs files of this decoder
         /// Returns a JS array with two elements: the start timestamp object and the end timestamp object
         Napi::Value GetTimestampRange(const Napi::CallbackInfo& info);
@@ -33,11 +133,72 @@ namespace nbs {
         /// Returns a JS array of packet objects
         Napi::Value GetPackets(const Napi::CallbackInfo& info);
 
+        /// Get the packets of the given types at each of many timestamps, like calling getPackets() for each one
+        /// Returns a JS object with the distinct packets, and a Uint32Array of which packet each type has at each time
+        Napi::Value GetPacketsAt(const Napi::CallbackInfo& info);
+
+        /// Get all the packets of the given types with timestamps between the given start and end, in timestamp order
+        /// Returns a JS array of packet objects
+        Napi::Value GetPacketsInRange(const Napi::CallbackInfo& info);
+
+        /// Like getPacketsInRange(), but copies the payloads into one Buffer and returns the other fields as columns
+        /// Returns a JS object of typed arrays, with the payloads Buffer and the types the type ids refer to
+        Napi::Value GetPacketColumns(const Napi::CallbackInfo& info);
+
+        /// Like getPackets(), but reads the packets on the thread pool
+        /// Returns a promise for a JS array of packet objects
+        Napi::Value GetPacketsAsync(const Napi::CallbackInfo& info);
+
+        /// Like getPacketsInRange(), but reads the packets on the thread pool
+        /// Returns a promise for a JS array of packet objects
+        Napi::Value GetPacketsInRangeAsync(const Napi::CallbackInfo& info);
+
+        /// Open a decoder, building its index on the thread pool
+        /// Returns a promise for the decoder
+        static Napi::Value Open(const Napi::CallbackInfo& info);
+
+        /// Share this decoder's index and memory maps with decoders on other threads, without copying them
+        /// Returns a JS handle object that can be posted to a worker and given to fromShared()
+        Napi::Value Share(const Napi::CallbackInfo& info);
+
+        /// Create a decoder that reads the index and memory maps of a decoder shared with share()
+        /// Returns the new decoder
+        static Napi::Value FromShared(const Napi::CallbackInfo& info);
+
         /// Get the packet at the given index of the given type subtype
         Napi::Value GetPacketByIndex(const Napi::CallbackInfo& info);
 
         Napi::Value NextTimestamp(const Napi::CallbackInfo& info);
 
+        /// Get how the timestamps of each type are searched, and how many searches and probes there have been
+        /// Returns a JS array of search stats objects, one for each available type
+        Napi::Value GetSearchStats(const Napi::CallbackInfo& info);
+
+        /// Create a cursor that steps through the packets of some or all types in timestamp order
+        /// Returns a JS object with `next`, `prev`, and `seek` functions
+        Napi::Value Cursor(const Napi::CallbackInfo& info);
+
+        /// Create a cursor that gets the packets of the given types at a timestamp, like getPackets(), searching from
+        /// where it found them last time
+        /// Returns a JS object with a `seek` function
+        Napi::Value TypeCursor(const Napi::CallbackInfo& info);
+
+        /// Get how well the packet cache is working
+        /// Returns a JS object with the number of hits and misses, and the number and size of the cached packets
+        Napi::Value GetCacheStats(const Napi::CallbackInfo& info);
+
+        /// Tell the OS that the packets of the given types between the given start and end will be read soon
+        void Prefetch(const Napi::CallbackInfo& info);
+
+        /// Release the loaded index items of the given types (or all types) of a lazy decoder
+        void Evict(const Napi::CallbackInfo& info);
+
+        /// Start following the nbs files for packets appended to them, calling the given JS callback with each batch
+        void Follow(const Napi::CallbackInfo& info);
+
+        /// Stop following the nbs files
+        void Unfollow(const Napi::CallbackInfo& info);
+
         /**
          * Close the readers to this decoder's nbs files.
          *
@@ -46,21 +207,57 @@ namespace nbs {
         void Close(const Napi::CallbackInfo& info);
 
     private:
-        /// Holds the index for the nbs files loaded in this decoder
-        Index index;
+        /// The index and memory maps for the nbs files loaded in this decoder
+        std::shared_ptr<DecoderFiles> files;
+
+        /// Keeps the JS packets that were read most recently
+        std::unique_ptr<PacketCache> packetCache;
+
+        /// Follows the nbs files for new packets, when following
+        std::unique_ptr<Follower> follower;
 
-        /// Memory maps for each nbs file in the index, indexed by the file order in the list
-        /// of file paths used to construct this decoder
-        std::vector<mio::basic_mmap_source<uint8_t>> memoryMaps;
+        /// Add a batch of packets appended to the nbs files to the index, and create the event for the JS callback
+        Napi::Value ApplyFollowBatch(const Napi::Env& env, const Follower::Batch& batch);
 
-        /// Get the list of packets at the given timestamp matching the given list of types and subtypes
-        std::vector<Packet> GetMatchingPackets(const uint64_t& timestamp, const std::vector<TypeSubtype>& types);
+        /// The arguments of getPackets()
+        struct PacketsQuery {
+            uint64_t timestamp = 0;
+            std::vector<TypeSubtype> types;
+        };
 
-        /// Read the packet for the given index item
-        Packet Read(const IndexItemFile& item);
+        /// The arguments of getPacketsInRange()
+        struct RangeQuery {
+            uint64_t start = 0;
+            uint64_t end   = 0;
+            std::vector<TypeSubtype> types;
+            size_t offset = 0;
+            size_t limit  = (std::numeric_limits<size_t>::max)();
+        };
+
+        /// Read the `paths` and `options` arguments of the constructor and open(), or throw a JS exception and return
+        /// false if they are invalid
+        static bool ParseOpenArguments(const Napi::CallbackInfo& info,
+                                       std::vector<std::string>& paths,
+                                       IndexOptions& indexOptions,
+                                       ReadOptions& readOptions);
+
+        /// Read the arguments of getPackets(), or throw a JS exception and return false if they are invalid
+        bool ParsePacketsQuery(const Napi::CallbackInfo& info, PacketsQuery& query);
+
+        /// Read the arguments of getPacketsInRange(), or throw a JS exception and return false if they are invalid
+        bool ParseRangeQuery(const Napi::CallbackInfo& info, RangeQuery& query);
+
+        /// Read the JS packet for the given index item, from the packet cache if it is there
+        Napi::Value ReadJsPacket(const IndexItemFile& item, const Napi::Env& env);
 
         /// Convert the given JS object with `type` and `subtype` properties to a TypeSubtype struct
         TypeSubtype TypeSubtypeFromJsValue(const Napi::Value& jsTypeSubtype, const Napi::Env& env);
+
+        /// Check if the given JS value is a Uint32Array of type ids, such as one from resolveTypes()
+        static bool IsTypeIds(const Napi::Value& value);
+
+        /// Get the types with the given ids from resolveTypes(), skipping the ids of types that aren't in the index
+        std::vector<TypeSubtype> TypesFromJsIds(const Napi::Value& jsIds) const;
     };
 
 }  // namespace nbs
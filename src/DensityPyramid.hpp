@@ -0,0 +1,162 @@
+#ifndef NBS_DENSITYPYRAMID_HPP
+#define NBS_DENSITYPYRAMID_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "IndexItem.hpp"
+#include "TypeColumns.hpp"
+
+namespace nbs {
+
+    /**
+     * A summary of how the items of one type are spread over time, at power of two bucket widths.
+     *
+     * Each bucket of the bottom level covers 2^shift nanoseconds, aligned to a multiple of its width, and each level
+     * above merges pairs of buckets from the level below, up to a single bucket that covers every item. The bottom
+     * level has at most MAX_LEAVES buckets, so the pyramid takes at most 2 * MAX_LEAVES buckets however many items
+     * the type has. Any range can be summarised into buckets of a power of two width from the level with that width,
+     * in time proportional to the number of buckets.
+     */
+    class DensityPyramid {
+    public:
+        /// The most buckets in the bottom level
+        static constexpr size_t MAX_LEAVES = 16384;
+
+        /// A summary of the items in a bucket
+        struct Bucket {
+            /// The number of items
+            uint64_t count = 0;
+
+            /// The total length of the items' packets, including their headers
+            uint64_t bytes = 0;
+
+            /// The first and last timestamps of the items, or 0 if there are none
+            uint64_t min = 0;
+            uint64_t max = 0;
+
+            /// Add an item to the bucket
+            void add(const uint64_t& timestamp, const uint64_t& length) {
+                min = count == 0 ? timestamp : std::min(min, timestamp);
+                max = count == 0 ? timestamp : std::max(max, timestamp);
+                count++;
+                bytes += length;
+            }
+
+            /// Add the items of another bucket to this one
+            void add(const Bucket& other) {
+                if (other.count == 0) {
+                    return;
+                }
+                min = count == 0 ? other.min : std::min(min, other.min);
+                max = count == 0 ? other.max : std::max(max, other.max);
+                count += other.count;
+                bytes += other.bytes;
+            }
+        };
+
+        DensityPyramid() = default;
+
+        /// Build the pyramid for the given items
+        explicit DensityPyramid(const TypeColumns& columns) {
+            if (columns.size() == 0) {
+                return;
+            }
+
+            // Use the narrowest buckets that keep the bottom level within its limit, or about one bucket per item for
+            // types with fewer items than that
+            const uint64_t first = columns.firstTimestamp();
+            const uint64_t last  = columns.lastTimestamp();
+            const uint64_t limit = std::min<uint64_t>(MAX_LEAVES, columns.size());
+            while ((last >> shift) - (first >> shift) + 1 > limit) {
+                shift++;
+            }
+
+            Level bottom;
+            bottom.first = first >> shift;
+            bottom.buckets.resize(size_t((last >> shift) - bottom.first + 1));
+            columns.forEach(0, columns.size(), [&](const IndexItemFile& itemFile) {
+                bottom.buckets[size_t((itemFile.item.timestamp >> shift) - bottom.first)].add(itemFile.item.timestamp,
+                                                                                            itemFile.item.length);
+            });
+            levels.push_back(std::move(bottom));
+
+            while (levels.back().buckets.size() > 1) {
+                const Level& below = levels.back();
+
+                Level above;
+                above.first = below.first >> 1;
+                above.buckets.resize(size_t(((below.first + below.buckets.size() - 1) >> 1) - above.first + 1));
+                for (size_t i = 0; i < below.buckets.size(); i++) {
+                    above.buckets[size_t(((below.first + i) >> 1) - above.first)].add(below.buckets[i]);
+                }
+
+                levels.push_back(std::move(above));
+            }
+        }
+
+        /// Get the log2 of the width of the narrowest buckets
+        unsigned getShift() const {
+            return shift;
+        }
+
+        /**
+         * Summarise the items in buckets of 2^`bucketShift` nanoseconds, aligned to multiples of their width, from the
+         * bucket containing `start` to the bucket containing `end`
+         *
+         * @param start       a timestamp in the first bucket
+         * @param end         a timestamp in the last bucket, not before `start`
+         * @param bucketShift the log2 of the bucket width, which must be at least getShift() and less than 64
+         * @return            the summary of each bucket
+         */
+        std::vector<Bucket> query(const uint64_t& start, const uint64_t& end, const unsigned& bucketShift) const {
+            const uint64_t firstOut = start >> bucketShift;
+            const uint64_t lastOut  = end >> bucketShift;
+            std::vector<Bucket> out(size_t(lastOut - firstOut + 1));
+            if (levels.empty()) {
+                return out;
+            }
+
+            // Read the level with the requested width, or the top level if the buckets are wider than all the items
+            const size_t index    = std::min<size_t>(bucketShift - shift, levels.size() - 1);
+            const unsigned extra  = unsigned(bucketShift - shift - index);
+            const Level& level    = levels[index];
+            const uint64_t lastIn = level.first + level.buckets.size() - 1;
+
+            // Only the level's buckets in the range are read, apart from the single bucket of the top level
+            uint64_t from = level.first;
+            uint64_t to   = lastIn;
+            if (extra == 0) {
+                from = std::max(firstOut, level.first);
+                to   = std::min(lastOut, lastIn);
+            }
+
+            for (uint64_t bucket = from; bucket <= to; bucket++) {
+                const uint64_t outBucket = bucket >> extra;
+                if (outBucket >= firstOut && outBucket <= lastOut) {
+                    out[size_t(outBucket - firstOut)].add(level.buckets[size_t(bucket - level.first)]);
+                }
+            }
+
+            return out;
+        }
+
+    private:
+        /// The buckets of one width, from the first bucket with any items to the last
+        struct Level {
+            /// The timestamp of the first bucket divided by the bucket width
+            uint64_t first = 0;
+            std::vector<Bucket> buckets;
+        };
+
+        /// The log2 of the width of the bottom level's buckets
+        unsigned shift = 0;
+
+        /// The levels from the narrowest buckets to the widest
+        std::vector<Level> levels;
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_DENSITYPYRAMID_HPP
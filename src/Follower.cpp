@@ -0,0 +1,251 @@
+#include "Follower.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "Scanner.hpp"
+
+namespace nbs {
+
+    namespace {
+        /// The most bytes to read from an index file in each poll
+        constexpr uint64_t MAX_INDEX_READ = 16 * 1024 * 1024;
+    }  // namespace
+
+    struct Follower::IndexFile {
+        /// The path of the index file
+        std::string path;
+
+        /// Entries for packets before this position in the nbs file were already in the decoder's index
+        uint64_t start = 0;
+
+        /// How many bytes of the index file have been read
+        uint64_t read = 0;
+
+        /// Whether the index file is gzipped, which is checked once its first bytes have been written
+        bool checked    = false;
+        bool compressed = false;
+
+        /// Inflates the gzipped index file, keeping its state between polls since entries are written a few at a time
+        z_stream stream{};
+
+        /// The inflated bytes of an entry that hasn't been completely written yet
+        std::vector<uint8_t> partial;
+
+        /// Entries for packets that haven't been completely written to the nbs file yet, in the order they were read
+        std::vector<IndexItem> pending;
+
+        IndexFile(const std::string& path, const uint64_t& start) : path(path), start(start) {
+            // Inflate gzip or zlib data, like the index files read when the decoder was opened
+            inflateInit2(&this->stream, 15 + 32);
+        }
+
+        ~IndexFile() {
+            inflateEnd(&this->stream);
+        }
+
+        IndexFile(const IndexFile&)            = delete;
+        IndexFile& operator=(const IndexFile&) = delete;
+    };
+
+    Follower::Follower(const Napi::Env& env,
+                       const Napi::Function& callback,
+                       const std::vector<std::string>& paths,
+                       const std::vector<uint64_t>& offsets,
+                       const std::chrono::milliseconds& interval,
+                       Apply apply)
+        : shared(std::make_shared<Shared>()), paths(paths), offsets(offsets), interval(interval) {
+        this->shared->apply = std::move(apply);
+
+        for (size_t i = 0; i < paths.size(); i++) {
+            struct stat buffer {};
+            const std::string idxPath = paths[i] + ".idx";
+            this->indexFiles.emplace_back(stat(idxPath.c_str(), &buffer) == 0 ? new IndexFile(idxPath, offsets[i])
+                                                                               : nullptr);
+        }
+
+        // An unlimited queue, so the polling thread never has to wait for the JS thread
+        this->threadSafeCallback = Napi::ThreadSafeFunction::New(env, callback, "nbsdecoder follow", 0, 1);
+
+        this->thread = std::thread(&Follower::run, this);
+    }
+
+    Follower::~Follower() {
+        this->shared->active = false;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        this->thread.join();
+
+        this->threadSafeCallback.Release();
+    }
+
+    void Follower::run() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        while (!this->stopping) {
+            lock.unlock();
+
+            std::unique_ptr<Batch> batch(new Batch(this->poll()));
+
+            if (!batch->items.empty()) {
+                auto shared = this->shared;
+                auto status = this->threadSafeCallback.NonBlockingCall(
+                    batch.get(),
+                    [shared](Napi::Env env, Napi::Function callback, Batch* data) {
+                        std::unique_ptr<Batch> received(data);
+
+                        // The decoder may have stopped following (or been destroyed) since this batch was queued
+                        if (!shared->active) {
+                            return;
+                        }
+
+#ifdef NAPI_CPP_EXCEPTIONS
+                        // Let an exception from the JS callback be reported as an uncaught exception, rather than
+                        // unwinding into node
+                        try {
+                            callback.Call({shared->apply(env, *received)});
+                        }
+                        catch (const Napi::Error& error) {
+                            error.ThrowAsJavaScriptException();
+                        }
+#else
+                        callback.Call({shared->apply(env, *received)});
+#endif
+                    });
+
+                // The batch now belongs to the queued call
+                if (status == napi_ok) {
+                    batch.release();
+                }
+            }
+
+            lock.lock();
+            this->wake.wait_for(lock, this->interval, [this] { return this->stopping; });
+        }
+    }
+
+    Follower::Batch Follower::poll() {
+        Batch batch;
+
+        for (size_t i = 0; i < this->paths.size(); i++) {
+            // Fall back to reading the packet headers if the index file can no longer be read
+            if (this->indexFiles[i] && this->pollIndex(i, batch)) {
+                continue;
+            }
+            this->indexFiles[i].reset();
+
+            struct stat buffer {};
+            if (stat(this->paths[i].c_str(), &buffer) != 0 || uint64_t(buffer.st_size) <= this->offsets[i]) {
+                continue;
+            }
+
+            // Read everything written since the last complete packet
+            std::vector<uint8_t> data(uint64_t(buffer.st_size) - this->offsets[i]);
+            std::ifstream input(this->paths[i], std::ios_base::binary);
+            input.seekg(int64_t(this->offsets[i]));
+            input.read(reinterpret_cast<char*>(data.data()), int64_t(data.size()));
+            data.resize(size_t(input.gcount()));
+
+            std::vector<IndexItem> items;
+            this->offsets[i] += scanner::readPackets(data.data(), data.size(), this->offsets[i], items);
+
+            for (auto& item : items) {
+                batch.items.push_back(IndexItemFile{item, int(i)});
+            }
+        }
+
+        return batch;
+    }
+
+    bool Follower::pollIndex(const size_t& fileno, Batch& batch) {
+        IndexFile& file = *this->indexFiles[fileno];
+
+        struct stat idxBuffer {};
+        if (stat(file.path.c_str(), &idxBuffer) != 0) {
+            return false;
+        }
+
+        if (uint64_t(idxBuffer.st_size) > file.read) {
+            // Read a large index file a part at a time, such as when catching up on the entries that were already there
+            std::vector<uint8_t> data(std::min<uint64_t>(uint64_t(idxBuffer.st_size) - file.read, MAX_INDEX_READ));
+            std::ifstream input(file.path, std::ios_base::binary);
+            input.seekg(int64_t(file.read));
+            input.read(reinterpret_cast<char*>(data.data()), int64_t(data.size()));
+            data.resize(size_t(input.gcount()));
+            file.read += data.size();
+
+            // Index files that aren't gzipped are read as they are
+            if (!file.checked && file.partial.size() + data.size() >= 2) {
+                file.partial.insert(file.partial.end(), data.begin(), data.end());
+                file.checked    = true;
+                file.compressed = file.partial[0] == 0x1F && file.partial[1] == 0x8B;
+                data            = std::move(file.partial);
+                file.partial.clear();
+            }
+            else if (!file.checked) {
+                file.partial.insert(file.partial.end(), data.begin(), data.end());
+                data.clear();
+            }
+
+            if (!file.compressed) {
+                file.partial.insert(file.partial.end(), data.begin(), data.end());
+            }
+            else if (!data.empty()) {
+                uint8_t out[16384];
+                file.stream.next_in  = data.data();
+                file.stream.avail_in = uInt(data.size());
+                do {
+                    file.stream.next_out  = out;
+                    file.stream.avail_out = sizeof(out);
+                    int status            = inflate(&file.stream, Z_NO_FLUSH);
+                    file.partial.insert(file.partial.end(), out, file.stream.next_out);
+
+                    // Writers may append more gzip members, such as when a recording is continued
+                    if (status == Z_STREAM_END) {
+                        inflateReset(&file.stream);
+                    }
+                    else if (status == Z_BUF_ERROR) {
+                        break;
+                    }
+                    else if (status != Z_OK) {
+                        return false;
+                    }
+                } while (file.stream.avail_in > 0 || file.stream.avail_out == 0);
+            }
+
+            // Take the complete entries, skipping the ones for packets that were already indexed
+            const size_t complete = file.partial.size() - file.partial.size() % sizeof(IndexItem);
+            for (size_t offset = 0; offset < complete; offset += sizeof(IndexItem)) {
+                IndexItem item{};
+                std::memcpy(&item, file.partial.data() + offset, sizeof(IndexItem));
+                if (item.offset >= file.start) {
+                    file.pending.push_back(item);
+                }
+            }
+            file.partial.erase(file.partial.begin(), file.partial.begin() + int64_t(complete));
+        }
+
+        // Hand over the entries whose packets have been completely written to the nbs file
+        struct stat nbsBuffer {};
+        const uint64_t nbsSize = stat(this->paths[fileno].c_str(), &nbsBuffer) == 0 ? uint64_t(nbsBuffer.st_size) : 0;
+
+        auto written = std::find_if(file.pending.begin(), file.pending.end(), [&](const IndexItem& item) {
+            return item.offset + item.length > nbsSize;
+        });
+        for (auto it = file.pending.begin(); it != written; ++it) {
+            batch.items.push_back(IndexItemFile{*it, int(fileno)});
+            this->offsets[fileno] = std::max(this->offsets[fileno], it->offset + it->length);
+        }
+        file.pending.erase(file.pending.begin(), written);
+
+        return true;
+    }
+
+}  // namespace nbs
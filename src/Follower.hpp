@@ -0,0 +1,114 @@
+#ifndef NBS_FOLLOWER_HPP
+#define NBS_FOLLOWER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <napi.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IndexItem.hpp"
+
+namespace nbs {
+
+    /**
+     * Follows nbs files that are still being written, reading the packets that are appended to them.
+     *
+     * A background thread polls the size of each file, and reads any complete packets written since it last looked.
+     * Each batch of new packets is handed to the JS thread, where `apply` adds them to the decoder and returns the
+     * event to call the JS callback with. Polling is used rather than a file system notification API since it works
+     * the same everywhere, including for files on network drives.
+     *
+     * Files that had an index file when following started are followed through the entries appended to their index
+     * file, which have the packets' subtypes and message timestamps. Each entry is held back until its packet has
+     * been written to the nbs file. Files without an index file are followed by reading the packet headers, so their
+     * new packets have a subtype of 0 and the timestamps from the headers, as when they were scanned.
+     */
+    class Follower {
+    public:
+        /// The index items for the packets appended to the followed files since the last batch
+        struct Batch {
+            std::vector<IndexItemFile> items;
+        };
+
+        /// Called on the JS thread with each batch, returning the value to pass to the JS callback
+        using Apply = std::function<Napi::Value(const Napi::Env&, const Batch&)>;
+
+        /**
+         * Start following the given nbs files
+         *
+         * @param env      the JS environment
+         * @param callback the JS function to call with the value returned by `apply` for each batch
+         * @param paths    the paths of the nbs files to follow
+         * @param offsets  the position in each file to start reading packets from
+         * @param interval how long to wait between checking the files for new packets
+         * @param apply    called on the JS thread to add each batch of packets to the decoder
+         */
+        Follower(const Napi::Env& env,
+                 const Napi::Function& callback,
+                 const std::vector<std::string>& paths,
+                 const std::vector<uint64_t>& offsets,
+                 const std::chrono::milliseconds& interval,
+                 Apply apply);
+
+        /// Stops following the files. Batches that were already sent to the JS thread are dropped.
+        ~Follower();
+
+        Follower(const Follower&)            = delete;
+        Follower& operator=(const Follower&) = delete;
+
+    private:
+        /// State shared with the batches queued for the JS thread, which can outlive the follower
+        struct Shared {
+            std::atomic<bool> active{true};
+            Apply apply;
+        };
+
+        std::shared_ptr<Shared> shared;
+
+        /// The paths of the followed files
+        std::vector<std::string> paths;
+
+        /// The position in each file to read the next packet from, only used by the polling thread
+        std::vector<uint64_t> offsets;
+
+        /// The entries read from a followed index file
+        struct IndexFile;
+
+        /// The index file of each file, or null for files followed by reading their packet headers. Only used by the
+        /// polling thread.
+        std::vector<std::unique_ptr<IndexFile>> indexFiles;
+
+        /// How long to wait between polls
+        std::chrono::milliseconds interval;
+
+        /// Calls into the JS thread with each batch
+        Napi::ThreadSafeFunction threadSafeCallback;
+
+        /// Used to wake the polling thread when stopping
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        /// The polling thread
+        std::thread thread;
+
+        /// Poll the files until stopped
+        void run();
+
+        /// Read the complete packets appended to each file since the last poll
+        Batch poll();
+
+        /// Read the entries appended to the index file of the given file, and add the items for the packets that have
+        /// been written to the batch. Returns false if the index file can't be read.
+        bool pollIndex(const size_t& fileno, Batch& batch);
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_FOLLOWER_HPP
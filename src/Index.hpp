@@ -1,117 +1,376 @@
 #ifndef NBS_INDEX_HPP
 #define NBS_INDEX_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <iostream>
-#include <map>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <sys/stat.h>
 #include <vector>
 
+#include "DensityPyramid.hpp"
+#include "IndexCache.hpp"
 #include "IndexItem.hpp"
+#include "IndexMerge.hpp"
+#include "Parallel.hpp"
+#include "Scanner.hpp"
+#include "Timeline.hpp"
+#include "TypeColumns.hpp"
+#include "TypeIdMap.hpp"
 #include "TypeSubtype.hpp"
 #include "third-party/zstr/zstr.hpp"
 
 namespace nbs {
 
-    using IndexIterator = std::vector<IndexItemFile>::iterator;
+    /// Options for how an Index is loaded
+    struct IndexOptions {
+        /// Path of the index cache file to load from or write to, or empty to not use a cache
+        std::string cachePath;
+
+        /// When an nbs file has no index file it is scanned to build one. If set, write it out as the index file.
+        bool writeScannedIndex = false;
+
+        /// Types with at least this many items get a SearchTree for timestamp lookups, rather than a binary search
+        size_t searchTreeThreshold = 65536;
+
+        /// Search the timestamps of types that are spaced uniformly enough using a TimestampModel
+        bool interpolationSearch = true;
+
+        /// Count the searches of each type and the timestamps they probe, for getSearchStats()
+        bool searchStats = false;
+
+        /// Pack the items of each type into compact blocks, which takes much less memory but makes each lookup a
+        /// little slower. Has no effect with a cache, since the cache is memory mapped rather than held in memory.
+        bool compact = false;
+
+        /// Only find the types and their counts up front, and load each type's items the first time it is queried.
+        /// Has no effect with a cache, since a memory mapped cache is already only read as it is used.
+        bool lazy = false;
+    };
 
     class Index {
     public:
         /// Empty default constructor
         Index(){};
 
+        /// Index objects point into their own storage, so they can be moved but not copied
+        Index(const Index&)            = delete;
+        Index& operator=(const Index&) = delete;
+        Index(Index&&)                 = default;
+        Index& operator=(Index&&)      = default;
+
         /**
          * Construct a new Index object with items in the provided list of nbs file paths
          *
-         * @param paths the paths to the nbs files to load the index for
+         * If `options.cachePath` is set and the cache there is up to date with the nbs files, it is memory mapped and
+         * used directly. Otherwise the index is built and the cache (re)written. Without a cache, `options.lazy` only
+         * surveys the files for their types, and loads the items of each type when it is first queried.
+         *
+         * @param paths   the paths to the nbs files to load the index for
+         * @param options options for how the index is loaded
          */
         template <typename T>
-        Index(const T& paths) {
-            for (size_t i = 0; i < paths.size(); i++) {
-                auto& nbsPath       = paths[i];
-                std::string idxPath = nbsPath + ".idx";
+        Index(const T& paths, const IndexOptions& options = IndexOptions())
+            : searchTreeThreshold(options.searchTreeThreshold)
+            , interpolationSearch(options.interpolationSearch)
+            , searchStats(options.searchStats)
+            , compact(options.compact && options.cachePath.empty()) {
+            if (options.lazy && options.cachePath.empty()) {
+                this->survey(paths, options);
+                return;
+            }
 
-                // Currently we only handle nbs files that have an index file
-                // If there's no index file, throw
-                if (!this->fileExists(idxPath)) {
-                    throw std::runtime_error("nbs index not found for file: " + nbsPath);
-                }
+            std::vector<cache::FileStamp> stamps;
 
-                // Load the index file
-                zstr::ifstream input(idxPath, zstr::ifstream::binary);
+            if (!options.cachePath.empty()) {
+                stamps = cache::stamp(paths);
 
-                // Read the index items from the file
-                while (input.good()) {
-                    IndexItemFile itemFile{};
-                    input.read(reinterpret_cast<char*>(&itemFile.item), sizeof(IndexItem));
-                    itemFile.fileno = i;
+                if (cache::load(options.cachePath, stamps, this->cached)) {
+                    // Use the columns straight out of the memory mapped cache, which are already in type order
+                    this->columns.reserve(this->cached.typeCount);
+                    for (uint64_t i = 0; i < this->cached.typeCount; i++) {
+                        auto& range = this->cached.types[i];
+                        auto count  = range.end - range.begin;
 
-                    if (input.good()) {
-                        // Add the item to our flat list of all index items
-                        this->idx.push_back(itemFile);
+                        TypeColumns columns;
+                        columns.type       = TypeSubtype{range.type, range.subtype};
+                        columns.timestamps = Column<uint64_t>(this->cached.timestamps + range.begin, count);
+                        columns.offsets    = Column<uint64_t>(this->cached.offsets + range.begin, count);
+                        columns.lengths    = Column<uint32_t>(this->cached.lengths + range.begin, count);
+                        columns.filenos    = Column<uint32_t>(this->cached.filenos + range.begin, count);
 
-                        // Add the item to our map of index items by type/subtype
-                        this->typeMap[TypeSubtype{itemFile.item.type, itemFile.item.subtype}];
+                        this->addType(std::move(columns));
                     }
+
+                    this->prepareTypes();
+                    return;
+                }
+
+                // Drop any stale mapping so the cache file can be replaced
+                this->cached.map.unmap();
+            }
+
+            this->build(paths, options);
+
+            // Failing to write the cache (e.g. a read only directory) just means we'll build the index again next time
+            if (!options.cachePath.empty()) {
+                std::vector<const TypeColumns*> columns;
+                for (auto& type : this->columns) {
+                    columns.push_back(&type);
+                }
+                cache::write(options.cachePath, stamps, columns);
+            }
+
+            this->prepareTypes();
+        }
+
+        /// Get the dense id of the given type and subtype, or NO_TYPE_ID if the type isn't in the index
+        TypeId getTypeId(const TypeSubtype& type) const {
+            return this->typeIds.find(type);
+        }
+
+        /// Get the number of types and subtypes in the index. Type ids run from 0 up to this count.
+        size_t getTypeCount() const {
+            return this->columns.size();
+        }
+
+        /// Get the type and subtype with the given id, which must be a valid id. This doesn't load a lazy type.
+        const TypeSubtype& getType(const TypeId& id) const {
+            return this->columns[id].type;
+        }
+
+        /// Get the index items for the type and subtype with the given id, which must be a valid id
+        const TypeColumns& getColumns(const TypeId& id) const {
+            if (this->lazy) {
+                this->load(std::vector<TypeId>{id});
+            }
+            return this->columns[id];
+        }
+
+        /// Get the index items for the type and subtype with the given id as they are, without loading them into a
+        /// lazy index
+        const TypeColumns& peekColumns(const TypeId& id) const {
+            return this->columns[id];
+        }
+
+        /// Get the index items for the given type and subtype, or nullptr if the type isn't in the index
+        const TypeColumns* getColumnsForType(const TypeSubtype& type) const {
+            TypeId id = this->typeIds.find(type);
+            return id != NO_TYPE_ID ? &this->getColumns(id) : nullptr;
+        }
+
+        /// Get the index items for each of the given types and subtypes, skipping types that aren't in the index
+        std::vector<const TypeColumns*> getColumnsForTypes(const std::vector<TypeSubtype>& types) const {
+            std::vector<TypeId> ids;
+            for (auto& type : types) {
+                TypeId id = this->typeIds.find(type);
+                if (id != NO_TYPE_ID) {
+                    ids.push_back(id);
                 }
             }
 
-            // Sort the index by type, then subtype, then timestamp
-            std::sort(this->idx.begin(), this->idx.end(), [](const IndexItemFile& a, const IndexItemFile& b) {
+            return this->getColumnsForIds(ids);
+        }
+
+        /// Get the index items for each of the types and subtypes with the given ids, which must be valid ids
+        std::vector<const TypeColumns*> getColumnsForIds(const std::vector<TypeId>& ids) const {
+            // Load all the types together, so the files only have to be read once
+            if (this->lazy) {
+                this->load(ids);
+            }
+
+            std::vector<const TypeColumns*> matches;
+            for (auto& id : ids) {
+                matches.push_back(&this->columns[id]);
+            }
+
+            return matches;
+        }
+
+        /// Check if the index is lazy, and only loads the items of each type when it is first used
+        bool isLazy() const {
+            return this->lazy != nullptr;
+        }
+
+        /**
+         * Add index items to the index, such as ones for packets appended to the nbs files after they were indexed.
+         * Types that weren't in the index before are given the next type ids. The index must not be lazy.
+         *
+         * @param items the index items to add
+         */
+        void append(std::vector<IndexItemFile> items) {
+            std::stable_sort(items.begin(), items.end(), [](const IndexItemFile& a, const IndexItemFile& b) {
                 return a.item.type != b.item.type         ? a.item.type < b.item.type
                        : a.item.subtype != b.item.subtype ? a.item.subtype < b.item.subtype
                                                           : a.item.timestamp < b.item.timestamp;
             });
 
-            // Populate the type map
-            for (auto& mapEntry : this->typeMap) {
-                IndexItemFile comparisonValue{};
-                comparisonValue.item.type    = mapEntry.first.type;
-                comparisonValue.item.subtype = mapEntry.first.subtype;
+            for (auto begin = items.begin(); begin != items.end();) {
+                TypeSubtype type{begin->item.type, begin->item.subtype};
 
-                // The value of the map entry a pair of iterators: the first iterator points to
-                // the first item in the vector that matches the comparison value, the second
-                // iterator points to one past the last matching item
-                mapEntry.second = std::equal_range(
-                    idx.begin(),
-                    idx.end(),
-                    comparisonValue,
-                    [](const IndexItemFile& a, const IndexItemFile& b) {
-                        return a.item.type != b.item.type ? a.item.type < b.item.type : a.item.subtype < b.item.subtype;
-                    });
+                auto end = std::find_if(begin, items.end(), [&](const IndexItemFile& itemFile) {
+                    return itemFile.item.type != type.type || itemFile.item.subtype != type.subtype;
+                });
+
+                TypeId id = this->typeIds.find(type);
+                if (id == NO_TYPE_ID) {
+                    TypeColumns columns;
+                    columns.type = type;
+
+                    id = TypeId(this->columns.size());
+                    this->addType(std::move(columns));
+                }
+
+                auto& columns = this->columns[id];
+                columns.insert(std::vector<IndexItemFile>(begin, end));
+                this->prepare(columns);
+
+                begin = end;
             }
+
+            // The timeline refers to the old columns, and the density pyramids summarise them
+            this->timeline.reset();
+            this->densities.clear();
+            this->version = nextVersion();
         }
 
-        /// Get the iterator range (begin, end) for the given type and subtype in the index
-        std::pair<nbs::IndexIterator, nbs::IndexIterator> getIteratorForType(const TypeSubtype& type) {
-            // Check that the type actually exists, otherwise the type map will add the given type
-            // with an empty iterator
-            auto typeExists = (this->typeMap.find(type) != this->typeMap.end());
-            if (typeExists == true) {
-                return this->typeMap[type];
-            }
-            return {};
+        /**
+         * Get a number that identifies the index's items, which is different for every index and changes whenever
+         * items are added or evicted. Pointers to the index's columns and timeline stay valid until it changes.
+         */
+        uint64_t getVersion() const {
+            return this->version;
         }
 
-        /// Get a list of iterator ranges (begin, end) for the given list of type and subtype in the index
-        std::vector<std::pair<std::vector<IndexItemFile>::iterator, std::vector<IndexItemFile>::iterator>>
-            getIteratorsForTypes(const std::vector<TypeSubtype>& types) {
-            std::vector<std::pair<std::vector<IndexItemFile>::iterator, std::vector<IndexItemFile>::iterator>> matches;
+        /**
+         * Get every item in the index in timestamp order. The timeline is built the first time it is asked for, and
+         * again after items are added to the index. In a lazy index this loads every type.
+         */
+        const Timeline& getTimeline() const {
+            std::vector<TypeId> ids(this->columns.size());
+            for (size_t id = 0; id < ids.size(); id++) {
+                ids[id] = TypeId(id);
+            }
+
+            // Make sure evicted types are loaded again, since the timeline refers to their items
+            if (this->lazy) {
+                this->load(ids);
+            }
 
-            for (auto& type : types) {
-                if (this->typeMap.find(type) != this->typeMap.end()) {
-                    matches.push_back(this->typeMap[type]);
+            // Decoders on other threads may share the index, and ask for the timeline at the same time
+            std::lock_guard<std::mutex> lock(*this->buildMutex);
+            if (!this->timeline) {
+                std::vector<const TypeColumns*> types;
+                for (auto& id : ids) {
+                    types.push_back(&this->columns[id]);
                 }
+                this->timeline.reset(new Timeline(std::move(types)));
             }
 
-            return matches;
+            return *this->timeline;
+        }
+
+        /**
+         * Summarise the items of the type with the given id in buckets of 2^`shift` nanoseconds, aligned to multiples
+         * of their width, from the bucket containing `start` to the bucket containing `end`. Buckets at least as wide
+         * as those of the type's density pyramid are read from the pyramid, which is built the first time it is
+         * needed. Narrower buckets are counted from the items themselves.
+         *
+         * @param id    the id of the type, which must be valid
+         * @param start a timestamp in the first bucket
+         * @param end   a timestamp in the last bucket, not before `start`
+         * @param shift the log2 of the bucket width, less than 64
+         */
+        std::vector<DensityPyramid::Bucket> getDensity(const TypeId& id,
+                                                       const uint64_t& start,
+                                                       const uint64_t& end,
+                                                       const unsigned& shift) const {
+            const TypeColumns& columns = this->getColumns(id);
+
+            const DensityPyramid* pyramid = nullptr;
+            {
+                // Decoders on other threads may share the index, and ask for the same pyramid at the same time
+                std::lock_guard<std::mutex> lock(*this->buildMutex);
+                if (this->densities.size() <= id) {
+                    this->densities.resize(id + 1);
+                }
+                if (!this->densities[id]) {
+                    this->densities[id].reset(new DensityPyramid(columns));
+                }
+                pyramid = this->densities[id].get();
+            }
+
+            if (shift >= pyramid->getShift()) {
+                return pyramid->query(start, end, shift);
+            }
+
+            // Buckets this narrow only cover a few of the pyramid's narrowest buckets, so there are few items in them
+            const uint64_t first = start >> shift;
+            const uint64_t last  = end >> shift;
+            std::vector<DensityPyramid::Bucket> buckets(size_t(last - first + 1));
+
+            const size_t begin = columns.lowerBound(first << shift);
+            const size_t stop  = columns.upperBound((last << shift) | ((uint64_t(1) << shift) - 1));
+            columns.forEach(begin, stop, [&](const IndexItemFile& itemFile) {
+                buckets[size_t((itemFile.item.timestamp >> shift) - first)].add(itemFile.item.timestamp,
+                                                                                 itemFile.item.length);
+            });
+
+            return buckets;
+        }
+
+        /// Get the position just past the last indexed packet in each of the `fileCount` nbs files
+        std::vector<uint64_t> getFileEnds(const size_t& fileCount) const {
+            std::vector<uint64_t> ends(fileCount, 0);
+
+            for (auto& columns : this->columns) {
+                columns.forEach(0, columns.size(), [&](const IndexItemFile& itemFile) {
+                    auto& end = ends[itemFile.fileno];
+                    end       = std::max(end, itemFile.item.offset + itemFile.item.length);
+                });
+            }
+
+            return ends;
+        }
+
+        /**
+         * Release the loaded items of the types with the given ids, which are loaded again the next time they are
+         * queried. This does nothing unless the index is lazy, and must not be called while items of these types are
+         * still being used.
+         */
+        void evict(const std::vector<TypeId>& ids) {
+            if (!this->lazy) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(this->lazy->mutex);
+            for (auto& id : ids) {
+                if (this->lazy->loaded[id]) {
+                    TypeColumns empty;
+                    empty.type             = this->columns[id].type;
+                    this->columns[id]      = std::move(empty);
+                    this->lazy->loaded[id] = false;
+                    this->version          = nextVersion();
+                }
+            }
         }
 
-        /// Get a list of all types and subtypes in the index
-        std::vector<TypeSubtype> getTypes() {
+        /// Get a list of all types and subtypes in the index, sorted by type and subtype
+        std::vector<TypeSubtype> getTypes() const {
             std::vector<TypeSubtype> types;
+            types.reserve(this->columns.size());
 
-            for (auto& mapEntry : this->typeMap) {
-                types.push_back(mapEntry.first);
+            for (auto& columns : this->columns) {
+                types.push_back(columns.type);
+            }
+
+            // Types added by append() are given the next ids, so the ids are only in type order until then
+            if (!std::is_sorted(types.begin(), types.end())) {
+                std::sort(types.begin(), types.end());
             }
 
             return types;
@@ -121,35 +380,26 @@ namespace nbs {
         // Get timestamp where as many subtypes move forward without moving forward twice.
         std::uint64_t nextTimestamp(const uint64_t& timestamp,
                                     const std::vector<TypeSubtype>& types,
-                                    const int& steps) {
+                                    const int& steps) const {
 
-            auto matchingIndexItems = this->getIteratorsForTypes(types);  // Iterator for each type(s).
+            auto matchingIndexItems = this->getColumnsForTypes(types);  // Columns for each type(s).
 
             bool best_found         = false;
             uint64_t best_timestamp = std::numeric_limits<uint64_t>::max();
             uint64_t best_delta     = std::numeric_limits<uint64_t>::max();
 
-            for (auto& range : matchingIndexItems) {
-                auto& begin = range.first;
-                auto& end   = range.second;
-
-                IndexItemFile target;
-                target.item.timestamp = timestamp;
-
-                if (begin != end) {
+            for (auto& columns : matchingIndexItems) {
+                if (columns->size() != 0) {
                     // Find the first item with a timestamp greater than the requested timestamp.
-                    auto position =
-                        std::upper_bound(begin, end, target, [](const IndexItemFile& a, const IndexItemFile& b) {
-                            return a.item.timestamp < b.item.timestamp;
-                        });
+                    auto position = columns->upperBound(timestamp);
 
-                    int length = std::distance(begin, end);
-                    int target = std::distance(begin, position) - 1 + steps;
+                    int length = columns->size();
+                    int target = int(position) - 1 + steps;
 
                     // Prevent position going past begin or end, return respective iterator timestamp.
                     if (0 <= target && target < length) {
                         best_found     = true;
-                        auto ts        = std::next(begin, target)->item.timestamp;
+                        auto ts        = columns->timestamp(target);
                         uint64_t delta = steps > 0 ? ts - timestamp : timestamp - ts;
                         if (delta < best_delta) {
                             best_delta     = delta;
@@ -162,12 +412,10 @@ namespace nbs {
             if (!best_found) {
                 uint64_t min_timestamp = std::numeric_limits<uint64_t>::max();
                 uint64_t max_timestamp = std::numeric_limits<uint64_t>::min();
-                for (auto& range : matchingIndexItems) {
-                    auto& begin = range.first;
-                    auto& end   = range.second;
-                    if (begin != end) {
-                        min_timestamp = std::min(min_timestamp, begin->item.timestamp);
-                        max_timestamp = std::max(max_timestamp, std::prev(end)->item.timestamp);
+                for (auto& columns : matchingIndexItems) {
+                    if (columns->size() != 0) {
+                        min_timestamp = std::min(min_timestamp, columns->firstTimestamp());
+                        max_timestamp = std::max(max_timestamp, columns->lastTimestamp());
                     }
                 }
 
@@ -181,22 +429,141 @@ namespace nbs {
         }
 
 
+        /**
+         * Get the items of the given types with timestamps from `start` to `end` (inclusive), in timestamp order.
+         * Items with the same timestamp are in the order of their types in `types`.
+         *
+         * Pages of a large range can be read by skipping the items of the earlier pages with `offset`. The skipped
+         * items are found with a binary search on timestamp across all the types, so a page deep into the range
+         * costs about the same as the first one.
+         *
+         * @param start  the first timestamp in the range
+         * @param end    the last timestamp in the range
+         * @param types  the types and subtypes to get items for, skipping types that aren't in the index
+         * @param offset the number of items at the start of the range to skip
+         * @param limit  the most items to return
+         * @return       the items in the range, in timestamp order
+         */
+        std::vector<IndexItemFile> getItemsInRange(const uint64_t& start,
+                                                   const uint64_t& end,
+                                                   const std::vector<TypeSubtype>& types,
+                                                   const size_t& offset,
+                                                   const size_t& limit) const {
+            std::vector<IndexItemFile> items;
+
+            auto matchingIndexItems = this->getColumnsForTypes(types);
+            if (start > end || limit == 0 || matchingIndexItems.empty()) {
+                return items;
+            }
+
+            // Find each type's items in the range
+            std::vector<size_t> begins;
+            std::vector<size_t> ends;
+            for (auto& columns : matchingIndexItems) {
+                begins.push_back(columns->lowerBound(start));
+                ends.push_back(columns->upperBound(end));
+            }
+
+            // Find the latest timestamp with at most `offset` items before it, and skip every item before it
+            auto countBefore = [&](const uint64_t& timestamp) {
+                size_t count = 0;
+                for (size_t i = 0; i < matchingIndexItems.size(); i++) {
+                    count += std::min(std::max(matchingIndexItems[i]->lowerBound(timestamp), begins[i]), ends[i])
+                             - begins[i];
+                }
+                return count;
+            };
+
+            size_t skip = offset;
+            if (offset > 0) {
+                uint64_t low  = start;
+                uint64_t high = end;
+                while (low < high) {
+                    const uint64_t middle = low + (high - low) / 2 + 1;
+                    if (countBefore(middle) <= offset) {
+                        low = middle;
+                    }
+                    else {
+                        high = middle - 1;
+                    }
+                }
+
+                skip -= countBefore(low);
+                for (size_t i = 0; i < matchingIndexItems.size(); i++) {
+                    begins[i] = std::min(std::max(matchingIndexItems[i]->lowerBound(low), begins[i]), ends[i]);
+                }
+            }
+
+            // No type can give more than the rest of the skipped items and a full page, so read at most that many of
+            // each type's items in one go, which is much faster than reading them one by one from packed columns
+            const size_t most = limit > (std::numeric_limits<size_t>::max)() - skip ? limit : skip + limit;
+            std::vector<std::vector<IndexItemFile>> candidates(matchingIndexItems.size());
+            for (size_t i = 0; i < matchingIndexItems.size(); i++) {
+                const size_t last = ends[i] - begins[i] > most ? begins[i] + most : ends[i];
+                matchingIndexItems[i]->forEach(begins[i], last, [&](const IndexItemFile& itemFile) {
+                    candidates[i].push_back(itemFile);
+                });
+            }
+
+            // Merge the types by timestamp, keeping the next item of each in a min heap
+            std::vector<std::pair<size_t, size_t>> heads;
+            auto later = [&](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+                const uint64_t aTimestamp = candidates[a.first][a.second].item.timestamp;
+                const uint64_t bTimestamp = candidates[b.first][b.second].item.timestamp;
+                return aTimestamp != bTimestamp ? aTimestamp > bTimestamp : a.first > b.first;
+            };
+
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (!candidates[i].empty()) {
+                    heads.emplace_back(i, 0);
+                }
+            }
+            std::make_heap(heads.begin(), heads.end(), later);
+
+            while (!heads.empty() && items.size() < limit) {
+                std::pop_heap(heads.begin(), heads.end(), later);
+                auto& head = heads.back();
+
+                if (skip > 0) {
+                    skip--;
+                }
+                else {
+                    items.push_back(candidates[head.first][head.second]);
+                }
+
+                if (++head.second == candidates[head.first].size()) {
+                    heads.pop_back();
+                }
+                else {
+                    std::push_heap(heads.begin(), heads.end(), later);
+                }
+            }
+
+            return items;
+        }
+
         /// Get the first and last timestamps across all items in the index
-        std::pair<uint64_t, uint64_t> getTimestampRange() {
+        std::pair<uint64_t, uint64_t> getTimestampRange() const {
             // std::numeric_limits<uint64_t>::max is wrapped in () here to workaround an issue on Windows
             // See https://stackoverflow.com/a/27443191
             std::pair<uint64_t, uint64_t> range{(std::numeric_limits<uint64_t>::max)(), 0};
 
-            for (auto& mapEntry : this->typeMap) {
-                const IndexItem& firstItem = mapEntry.second.first->item;
-                const IndexItem& lastItem  = (mapEntry.second.second - 1)->item;
+            // A lazy index keeps the range of every type from its survey, so nothing needs to be loaded
+            if (this->lazy) {
+                for (auto& summary : this->lazy->summaries) {
+                    range.first  = std::min(range.first, summary.first);
+                    range.second = std::max(range.second, summary.last);
+                }
+                return range;
+            }
 
-                if (firstItem.timestamp < range.first) {
-                    range.first = firstItem.timestamp;
+            for (auto& columns : this->columns) {
+                if (columns.firstTimestamp() < range.first) {
+                    range.first = columns.firstTimestamp();
                 }
 
-                if (lastItem.timestamp > range.second) {
-                    range.second = lastItem.timestamp;
+                if (columns.lastTimestamp() > range.second) {
+                    range.second = columns.lastTimestamp();
                 }
             }
 
@@ -204,26 +571,336 @@ namespace nbs {
         }
 
         /// Get the first and last timestamps in the index for the given type and subtype
-        std::pair<uint64_t, uint64_t> getTimestampRange(const TypeSubtype& type) {
+        std::pair<uint64_t, uint64_t> getTimestampRange(const TypeSubtype& type) const {
             std::pair<uint64_t, uint64_t> range{0, 0};
 
-            if (this->typeMap.find(type) != this->typeMap.end()) {
-                auto iteratorPair = this->typeMap[type];
+            if (this->lazy) {
+                TypeId id = this->typeIds.find(type);
+                if (id != NO_TYPE_ID) {
+                    range.first  = this->lazy->summaries[id].first;
+                    range.second = this->lazy->summaries[id].last;
+                }
+                return range;
+            }
 
-                range.first  = iteratorPair.first->item.timestamp;
-                range.second = (iteratorPair.second - 1)->item.timestamp;
+            auto columns = this->getColumnsForType(type);
+            if (columns != nullptr) {
+                range.first  = columns->firstTimestamp();
+                range.second = columns->lastTimestamp();
             }
 
             return range;
         }
 
     private:
-        /// The index data: a vector holding the index items
-        std::vector<IndexItemFile> idx;
+        /// The memory mapped index cache, when the index items were loaded from one
+        cache::Contents cached{};
+
+        /// The index items for each type and subtype, indexed by type id and sorted by type and subtype. The columns
+        /// either own their items or view them in the memory mapped cache. A lazy index fills them in from const
+        /// queries, so they are mutable.
+        mutable std::vector<TypeColumns> columns;
+
+        /// Maps a (type, subtype) to its id, which is its position in `columns`
+        TypeIdMap typeIds;
+
+        /// Types with at least this many items get a search tree
+        size_t searchTreeThreshold = (std::numeric_limits<size_t>::max)();
+
+        /// Whether types can be searched with a model of their timestamps
+        bool interpolationSearch = false;
+
+        /// Whether the searches of each type are counted
+        bool searchStats = false;
+
+        /// Whether the items of each type are packed into compact blocks
+        bool compact = false;
+
+        /// Give the next type id to the given columns. Types must be added in type and subtype order.
+        void addType(TypeColumns&& columns) {
+            this->typeIds.insert(columns.type, TypeId(this->columns.size()));
+            this->columns.push_back(std::move(columns));
+        }
+
+        /// The number of items of a type and their first and last timestamps, found when surveying a lazy index
+        struct TypeSummary {
+            TypeSubtype type{};
+            size_t count   = 0;
+            uint64_t first = (std::numeric_limits<uint64_t>::max)();
+            uint64_t last  = 0;
+        };
+
+        /// What a lazy index needs to load the items of a type later on
+        struct LazyState {
+            /// The nbs files, and which of them have an index file
+            std::vector<std::string> paths;
+            std::vector<bool> hasIndex;
+
+            /// The ids of the types in each file, so loading a type only reads the files it is in
+            std::vector<std::vector<TypeId>> fileTypes;
+
+            /// The summary of each type, indexed by type id
+            std::vector<TypeSummary> summaries;
+
+            /// Whether the items of each type are loaded, indexed by type id
+            std::vector<bool> loaded;
+
+            /// Held while loading or evicting types
+            std::mutex mutex;
+        };
+
+        /// Set when the index is lazy
+        std::unique_ptr<LazyState> lazy;
+
+        /// Every item in timestamp order, built when it is first needed
+        mutable std::unique_ptr<Timeline> timeline;
+
+        /// The density pyramid of each type, indexed by type id, built when each is first needed
+        mutable std::vector<std::unique_ptr<DensityPyramid>> densities;
+
+        /// Held while building the timeline or a density pyramid. Kept behind a pointer so the index can still be
+        /// moved.
+        std::unique_ptr<std::mutex> buildMutex{new std::mutex()};
+
+        /// Identifies the index's items, see getVersion()
+        uint64_t version = nextVersion();
+
+        /// Get a new index version
+        static uint64_t nextVersion() {
+            static std::atomic<uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// Pack the items of a type if the index is compact, and choose how to search its timestamps
+        void prepare(TypeColumns& columns) const {
+            if (this->compact) {
+                columns.pack();
+            }
+            columns.prepareSearch(this->searchTreeThreshold, this->interpolationSearch);
+            columns.stats.enabled = this->searchStats;
+        }
+
+        /// Prepare every type
+        void prepareTypes() {
+            parallel::forEach(this->columns.size(), [&](const size_t& i) { this->prepare(this->columns[i]); });
+        }
+
+        /// Build the index by reading the index files of the given nbs files, or scanning the nbs files that don't
+        /// have one
+        template <typename T>
+        void build(const T& paths, const IndexOptions& options) {
+            auto hasIndex = this->findIndexFiles(paths);
+
+            // Read each file and group its items by type
+            std::vector<merge::FileRuns> files(paths.size());
+            forEachFile(hasIndex, [&](const size_t& i) {
+                files[i] = merge::partition(readItems(paths[i], hasIndex[i], options.writeScannedIndex));
+            });
+
+            // Merge each type's runs from every file into its columns, sorted by timestamp, in type order
+            auto types = merge::allTypes(files);
+
+            std::vector<TypeColumns> merged(types.size());
+            parallel::forEach(types.size(), [&](const size_t& i) { merged[i] = merge::mergeType(types[i], files); });
+
+            this->columns.reserve(merged.size());
+            for (auto& columns : merged) {
+                this->addType(std::move(columns));
+            }
+        }
+
+        /// Set up a lazy index by finding the types in each file and their counts, without keeping any items
+        template <typename T>
+        void survey(const T& paths, const IndexOptions& options) {
+            auto hasIndex = this->findIndexFiles(paths);
+
+            // Summarise the types in each file
+            std::vector<std::vector<TypeSummary>> fileSummaries(paths.size());
+            forEachFile(hasIndex, [&](const size_t& i) {
+                TypeIdMap localIds;
+                auto& summaries = fileSummaries[i];
+
+                for (auto& item : readItems(paths[i], hasIndex[i], options.writeScannedIndex)) {
+                    TypeSubtype type{item.type, item.subtype};
+
+                    TypeId id = localIds.find(type);
+                    if (id == NO_TYPE_ID) {
+                        id = TypeId(summaries.size());
+                        localIds.insert(type, id);
+                        summaries.push_back(TypeSummary{type});
+                    }
+
+                    auto& summary = summaries[id];
+                    summary.count++;
+                    summary.first = std::min(summary.first, item.timestamp);
+                    summary.last  = std::max(summary.last, item.timestamp);
+                }
+            });
 
-        /// Maps a (type, subtype) to the iterator over the index items for that type and subtype
-        std::map<TypeSubtype, std::pair<std::vector<IndexItemFile>::iterator, std::vector<IndexItemFile>::iterator>>
-            typeMap;
+            // Give every type an id in type order, with no items loaded yet
+            std::vector<TypeSubtype> types;
+            for (auto& summaries : fileSummaries) {
+                for (auto& summary : summaries) {
+                    types.push_back(summary.type);
+                }
+            }
+            std::sort(types.begin(), types.end());
+            types.erase(std::unique(types.begin(), types.end()), types.end());
+
+            this->columns.reserve(types.size());
+            for (auto& type : types) {
+                TypeColumns columns;
+                columns.type = type;
+                this->addType(std::move(columns));
+            }
+
+            this->lazy = std::unique_ptr<LazyState>(new LazyState());
+            this->lazy->paths.assign(paths.begin(), paths.end());
+            this->lazy->hasIndex = hasIndex;
+            this->lazy->fileTypes.resize(paths.size());
+            this->lazy->summaries.resize(types.size());
+            this->lazy->loaded.resize(types.size(), false);
+
+            for (size_t i = 0; i < paths.size(); i++) {
+                for (auto& summary : fileSummaries[i]) {
+                    TypeId id = this->typeIds.find(summary.type);
+                    this->lazy->fileTypes[i].push_back(id);
+
+                    auto& total = this->lazy->summaries[id];
+                    total.type  = summary.type;
+                    total.count += summary.count;
+                    total.first = std::min(total.first, summary.first);
+                    total.last  = std::max(total.last, summary.last);
+                }
+            }
+        }
+
+        /// Load the items of any of the given types that aren't loaded yet, in a lazy index
+        void load(const std::vector<TypeId>& ids) const {
+            LazyState& state = *this->lazy;
+            std::lock_guard<std::mutex> lock(state.mutex);
+
+            std::vector<bool> wanted(state.loaded.size(), false);
+            std::vector<TypeId> missing;
+            for (auto& id : ids) {
+                if (!state.loaded[id] && !wanted[id]) {
+                    wanted[id] = true;
+                    missing.push_back(id);
+                }
+            }
+
+            if (missing.empty()) {
+                return;
+            }
+
+            // Only read the files that have some of the wanted types
+            std::vector<bool> needed(state.paths.size(), false);
+            for (size_t i = 0; i < state.paths.size(); i++) {
+                for (auto& id : state.fileTypes[i]) {
+                    needed[i] = needed[i] || wanted[id];
+                }
+            }
+
+            std::vector<merge::FileRuns> files(state.paths.size());
+            forEachFile(state.hasIndex, [&](const size_t& i) {
+                if (needed[i]) {
+                    auto items = readItems(state.paths[i], state.hasIndex[i], false);
+                    items.erase(std::remove_if(items.begin(),
+                                               items.end(),
+                                               [&](const IndexItem& item) {
+                                                   return !wanted[this->typeIds.find({item.type, item.subtype})];
+                                               }),
+                                items.end());
+                    files[i] = merge::partition(items);
+                }
+            });
+
+            parallel::forEach(missing.size(), [&](const size_t& i) {
+                TypeColumns columns = merge::mergeType(this->columns[missing[i]].type, files);
+                this->prepare(columns);
+                this->columns[missing[i]] = std::move(columns);
+            });
+
+            for (auto& id : missing) {
+                state.loaded[id] = true;
+            }
+        }
+
+        /// Check which of the given nbs files have an index file, throwing if a file has neither an index file nor
+        /// an nbs file. All the files are checked before loading anything so the first missing file is always the
+        /// one that gets reported.
+        template <typename T>
+        std::vector<bool> findIndexFiles(const T& paths) {
+            std::vector<bool> hasIndex(paths.size());
+            for (size_t i = 0; i < paths.size(); i++) {
+                hasIndex[i] = this->fileExists(paths[i] + ".idx");
+                if (!hasIndex[i] && !this->fileExists(paths[i])) {
+                    throw std::runtime_error("nbs index not found for file: " + paths[i]);
+                }
+            }
+            return hasIndex;
+        }
+
+        /// Call `fn` with the number of each file. The files with an index file are inflated and read on their own
+        /// worker threads, while the others are scanned one at a time since each scan is already spread across all
+        /// the cores.
+        template <typename F>
+        static void forEachFile(const std::vector<bool>& hasIndex, F&& fn) {
+            parallel::forEach(hasIndex.size(), [&](const size_t& i) {
+                if (hasIndex[i]) {
+                    fn(i);
+                }
+            });
+
+            for (size_t i = 0; i < hasIndex.size(); i++) {
+                if (!hasIndex[i]) {
+                    fn(i);
+                }
+            }
+        }
+
+        /// Read the index items of the given nbs file from its index file, or by scanning it if it doesn't have one
+        static std::vector<IndexItem> readItems(const std::string& path,
+                                                const bool& hasIndex,
+                                                const bool& writeScannedIndex) {
+            if (hasIndex) {
+                return readIndexFile(path + ".idx");
+            }
+
+            auto scanned = scanner::scan(path);
+
+            // Not being able to write the index file is fine, we'll just scan the file again next time
+            if (writeScannedIndex) {
+                try {
+                    scanner::writeIndex(path + ".idx", scanned);
+                }
+                catch (const std::exception&) {
+                    std::remove((path + ".idx").c_str());
+                }
+            }
+
+            return scanned;
+        }
+
+        /// Read all the index items from the gzipped index file at the given path
+        static std::vector<IndexItem> readIndexFile(const std::string& idxPath) {
+            std::vector<IndexItem> items;
+
+            // Load the index file
+            zstr::ifstream input(idxPath, zstr::ifstream::binary);
+
+            // Read the index items from the file
+            while (input.good()) {
+                IndexItem item{};
+                input.read(reinterpret_cast<char*>(&item), sizeof(IndexItem));
+
+                if (input.good()) {
+                    items.push_back(item);
+                }
+            }
+
+            return items;
+        }
 
         /// Check if a file exists at the given path
         bool fileExists(const std::string& path) {
@@ -0,0 +1,274 @@
+#ifndef NBS_INDEXCACHE_HPP
+#define NBS_INDEXCACHE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <vector>
+
+#include "TypeColumns.hpp"
+#include "TypeSubtype.hpp"
+#include "third-party/mio/mmap.hpp"
+#include "third-party/xxhash/xxhash.h"
+
+namespace nbs {
+
+    /**
+     * An on-disk cache of a fully built Index, which can be memory mapped and used directly on later opens.
+     *
+     * NBS Index Cache File Format (native byte order)
+     * Name       | Type                  |  Description
+     * ------------------------------------------------------------
+     * header     | Header                | magic, format version, and the number of each record that follows
+     * files      | FileStamp[fileCount]  | the identity of each source file the cache was built from
+     * types      | TypeRange[typeCount]  | the range of items for each type and subtype, ordered by type
+     * timestamps | uint64_t[itemCount]   | the timestamp column of every index item
+     * offsets    | uint64_t[itemCount]   | the offset column of every index item
+     * lengths    | uint32_t[itemCount]   | the length column of every index item
+     * filenos    | uint32_t[itemCount]   | the file number column of every index item
+     *
+     * Each column holds the items of each type in turn, in the order of the type ranges, sorted by timestamp.
+     * Everything before the 32 bit columns is a multiple of 8 bytes, so all the columns are suitably aligned to be
+     * used in place.
+     */
+    namespace cache {
+
+        /// Bumped whenever the layout of the cache file changes, so old caches are rebuilt
+        constexpr uint32_t VERSION = 2;
+
+        /// Identifies index cache files, and their byte order
+        constexpr uint64_t MAGIC = 0x314358444953424eULL;  // "NBSIDXC1" when read in little endian
+
+        struct Header {
+            uint64_t magic;
+            uint32_t version;
+            uint32_t fileCount;
+            uint64_t typeCount;
+            uint64_t itemCount;
+        };
+
+        /// The identity of a source nbs file: if any of these change the cache is stale
+        struct FileStamp {
+            uint64_t pathHash;
+            uint64_t nbsSize;
+            int64_t nbsModified;
+            uint64_t idxSize;
+            int64_t idxModified;
+        };
+
+        struct TypeRange {
+            uint64_t type;
+            uint32_t subtype;
+            uint32_t padding;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        static_assert(sizeof(Header) % 8 == 0, "cache header must keep the records after it aligned");
+        static_assert(sizeof(FileStamp) % 8 == 0, "cache file stamps must keep the records after them aligned");
+        static_assert(sizeof(TypeRange) % 8 == 0, "cache type ranges must keep the records after them aligned");
+
+        /// A memory mapped cache file that has been checked against the files it was built from
+        struct Contents {
+            mio::basic_mmap_source<uint8_t> map;
+            const TypeRange* types;
+            uint64_t typeCount;
+            const uint64_t* timestamps;
+            const uint64_t* offsets;
+            const uint32_t* lengths;
+            const uint32_t* filenos;
+            uint64_t itemCount;
+        };
+
+        /// Get the size and modification time (in nanoseconds) of the file at the given path, or zeros if it
+        /// doesn't exist
+        inline std::pair<uint64_t, int64_t> statFile(const std::string& path) {
+            struct stat buffer {};
+            if (stat(path.c_str(), &buffer) != 0) {
+                return {0, 0};
+            }
+
+#if defined(__APPLE__)
+            int64_t nanos = buffer.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+            int64_t nanos = buffer.st_mtim.tv_nsec;
+#else
+            int64_t nanos = 0;
+#endif
+            return {uint64_t(buffer.st_size), int64_t(buffer.st_mtime) * 1000000000LL + nanos};
+        }
+
+        /// Get the stamps for each of the given nbs files, used to key the cache
+        template <typename T>
+        std::vector<FileStamp> stamp(const T& paths) {
+            std::vector<FileStamp> stamps;
+
+            for (auto& path : paths) {
+                FileStamp fileStamp{};
+                fileStamp.pathHash = XXH64(path.c_str(), path.size(), 0);
+
+                auto nbs              = statFile(path);
+                fileStamp.nbsSize     = nbs.first;
+                fileStamp.nbsModified = nbs.second;
+
+                auto idx              = statFile(path + ".idx");
+                fileStamp.idxSize     = idx.first;
+                fileStamp.idxModified = idx.second;
+
+                stamps.push_back(fileStamp);
+            }
+
+            return stamps;
+        }
+
+        /**
+         * Memory map the cache file at the given path and check that it was built from files with the given stamps.
+         *
+         * @param cachePath the path of the cache file
+         * @param stamps    the current stamps of the nbs files the cache should have been built from
+         * @param contents  filled with the mapped cache if it is usable
+         * @return          true if the cache exists and is up to date, false if it needs to be rebuilt
+         */
+        inline bool load(const std::string& cachePath, const std::vector<FileStamp>& stamps, Contents& contents) {
+            std::error_code error;
+            contents.map.map(cachePath, 0, mio::map_entire_file, error);
+            if (error) {
+                return false;
+            }
+
+            const uint8_t* data = contents.map.data();
+            const uint64_t size = contents.map.size();
+
+            if (size < sizeof(Header)) {
+                return false;
+            }
+
+            Header header{};
+            std::memcpy(&header, data, sizeof(Header));
+
+            if (header.magic != MAGIC || header.version != VERSION || header.fileCount != stamps.size()) {
+                return false;
+            }
+
+            // Check the file is exactly the size the header says it is, which also catches truncated writes
+            const uint64_t typesOffset = sizeof(Header) + header.fileCount * sizeof(FileStamp);
+            const uint64_t itemsOffset = typesOffset + header.typeCount * sizeof(TypeRange);
+            const uint64_t itemSize    = sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2;
+            if (size != itemsOffset + header.itemCount * itemSize) {
+                return false;
+            }
+
+            if (std::memcmp(data + sizeof(Header), stamps.data(), stamps.size() * sizeof(FileStamp)) != 0) {
+                return false;
+            }
+
+            contents.types     = reinterpret_cast<const TypeRange*>(data + typesOffset);
+            contents.typeCount = header.typeCount;
+
+            // Make sure each type's range of items is within the mapped items
+            for (uint64_t i = 0; i < contents.typeCount; i++) {
+                if (contents.types[i].begin > contents.types[i].end || contents.types[i].end > header.itemCount) {
+                    return false;
+                }
+            }
+
+            contents.itemCount  = header.itemCount;
+            contents.timestamps = reinterpret_cast<const uint64_t*>(data + itemsOffset);
+            contents.offsets    = contents.timestamps + header.itemCount;
+            contents.lengths    = reinterpret_cast<const uint32_t*>(contents.offsets + header.itemCount);
+            contents.filenos    = contents.lengths + header.itemCount;
+
+            // Make sure each item is within one of the nbs files, as big as they were stamped, since packets are read
+            // straight out of them
+            for (uint64_t i = 0; i < contents.itemCount; i++) {
+                const uint32_t fileno = contents.filenos[i];
+                if (fileno >= stamps.size() || contents.offsets[i] > stamps[fileno].nbsSize
+                    || contents.lengths[i] > stamps[fileno].nbsSize - contents.offsets[i]) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// Write one column of every type to the given stream, one type after another
+        template <typename T>
+        void writeColumn(std::ofstream& output,
+                         const std::vector<const TypeColumns*>& columns,
+                         Column<T> TypeColumns::*column) {
+            for (auto& type : columns) {
+                auto& values = type->*column;
+                output.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+            }
+        }
+
+        /**
+         * Write a cache file for an index. The cache is written to a temporary file which is then moved into place,
+         * so readers never see a partially written cache.
+         *
+         * @param cachePath the path of the cache file
+         * @param stamps    the stamps of the nbs files the index was built from
+         * @param columns   the index items of each type and subtype, ordered by type
+         * @return          true if the cache was written
+         */
+        inline bool write(const std::string& cachePath,
+                          const std::vector<FileStamp>& stamps,
+                          const std::vector<const TypeColumns*>& columns) {
+            std::string tempPath = cachePath + ".tmp";
+
+            {
+                std::ofstream output(tempPath, std::ios_base::binary | std::ios_base::trunc);
+
+                // Work out where each type's items will be in the columns
+                std::vector<TypeRange> types;
+                uint64_t itemCount = 0;
+                for (auto& type : columns) {
+                    TypeRange range{};
+                    range.type    = type->type.type;
+                    range.subtype = type->type.subtype;
+                    range.begin   = itemCount;
+                    range.end     = itemCount + type->size();
+                    types.push_back(range);
+                    itemCount = range.end;
+                }
+
+                Header header{};
+                header.magic     = MAGIC;
+                header.version   = VERSION;
+                header.fileCount = uint32_t(stamps.size());
+                header.typeCount = types.size();
+                header.itemCount = itemCount;
+
+                output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+                output.write(reinterpret_cast<const char*>(stamps.data()), stamps.size() * sizeof(FileStamp));
+                output.write(reinterpret_cast<const char*>(types.data()), types.size() * sizeof(TypeRange));
+                writeColumn(output, columns, &TypeColumns::timestamps);
+                writeColumn(output, columns, &TypeColumns::offsets);
+                writeColumn(output, columns, &TypeColumns::lengths);
+                writeColumn(output, columns, &TypeColumns::filenos);
+
+                if (!output.good()) {
+                    output.close();
+                    std::remove(tempPath.c_str());
+                    return false;
+                }
+            }
+
+            // Windows won't rename over an existing file
+            std::remove(cachePath.c_str());
+            if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+                std::remove(tempPath.c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+    }  // namespace cache
+}  // namespace nbs
+
+#endif  // NBS_INDEXCACHE_HPP
@@ -0,0 +1,216 @@
+#ifndef NBS_INDEXMERGE_HPP
+#define NBS_INDEXMERGE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "IndexItem.hpp"
+#include "TypeColumns.hpp"
+#include "TypeIdMap.hpp"
+#include "TypeSubtype.hpp"
+
+namespace nbs {
+
+    /**
+     * Builds the per-type columns of an index from the index items of each file, without sorting all the items
+     * together.
+     *
+     * The items in an index file are written as packets arrive, so within each type they are almost always already in
+     * timestamp order. Each file's items are split into one run per type with a stable counting sort, any run that
+     * isn't in order is sorted on its own, and then the runs for each type are merged across files.
+     */
+    namespace merge {
+
+        /// The index items of a single file, grouped into one run per type and sorted by timestamp within each run
+        struct FileRuns {
+            /// The types in the file, sorted by type and subtype
+            std::vector<TypeSubtype> types;
+
+            /// The run for `types[i]` is items `[starts[i], starts[i + 1])`
+            std::vector<size_t> starts;
+
+            /// The items of the file, grouped by type
+            std::vector<IndexItem> items;
+        };
+
+        /**
+         * Group the items of a file by type, keeping their file order within each type, and then sort each type's
+         * run by timestamp if it isn't already.
+         *
+         * @param items the index items of the file, in file order
+         * @return      the items grouped into runs by type
+         */
+        inline FileRuns partition(const std::vector<IndexItem>& items) {
+            // Give each type a local id in the order they are first seen, and count the items of each
+            TypeIdMap localIds;
+            std::vector<TypeSubtype> seen;
+            std::vector<size_t> counts;
+            std::vector<TypeId> ids(items.size());
+
+            for (size_t i = 0; i < items.size(); i++) {
+                TypeSubtype type{items[i].type, items[i].subtype};
+
+                TypeId id = localIds.find(type);
+                if (id == NO_TYPE_ID) {
+                    id = TypeId(seen.size());
+                    localIds.insert(type, id);
+                    seen.push_back(type);
+                    counts.push_back(0);
+                }
+
+                ids[i] = id;
+                counts[id]++;
+            }
+
+            // Lay the runs out in type order
+            std::vector<TypeId> order(seen.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](const TypeId& a, const TypeId& b) { return seen[a] < seen[b]; });
+
+            FileRuns runs;
+            runs.types.reserve(seen.size());
+            runs.starts.reserve(seen.size() + 1);
+
+            std::vector<size_t> next(seen.size());
+            size_t start = 0;
+            for (auto& id : order) {
+                runs.types.push_back(seen[id]);
+                runs.starts.push_back(start);
+                next[id] = start;
+                start += counts[id];
+            }
+            runs.starts.push_back(start);
+
+            // Scatter the items into their runs, which keeps them in file order within each run
+            runs.items.resize(items.size());
+            for (size_t i = 0; i < items.size(); i++) {
+                runs.items[next[ids[i]]++] = items[i];
+            }
+
+            auto earlier = [](const IndexItem& a, const IndexItem& b) { return a.timestamp < b.timestamp; };
+            for (size_t i = 0; i < runs.types.size(); i++) {
+                auto begin = runs.items.begin() + runs.starts[i];
+                auto end   = runs.items.begin() + runs.starts[i + 1];
+                if (!std::is_sorted(begin, end, earlier)) {
+                    std::stable_sort(begin, end, earlier);
+                }
+            }
+
+            return runs;
+        }
+
+        /// Get every type that is in any of the files, sorted by type and subtype
+        inline std::vector<TypeSubtype> allTypes(const std::vector<FileRuns>& files) {
+            std::vector<TypeSubtype> types;
+
+            for (auto& file : files) {
+                std::vector<TypeSubtype> merged;
+                merged.reserve(types.size() + file.types.size());
+                std::set_union(types.begin(), types.end(), file.types.begin(), file.types.end(),
+                               std::back_inserter(merged));
+                types.swap(merged);
+            }
+
+            return types;
+        }
+
+        /// A run of a single type's items from one file, that is being merged
+        struct Run {
+            const IndexItem* begin;
+            const IndexItem* end;
+            uint32_t fileno;
+        };
+
+        /// Check if the next item of run `a` should come after the next item of run `b`. Equal timestamps are
+        /// ordered by file, so the merge is stable.
+        inline bool after(const Run& a, const Run& b) {
+            return a.begin->timestamp != b.begin->timestamp ? a.begin->timestamp > b.begin->timestamp
+                                                            : a.fileno > b.fileno;
+        }
+
+        /**
+         * Merge the runs of the given type from every file into a single set of columns, sorted by timestamp. Items
+         * with equal timestamps keep their file order.
+         *
+         * @param type  the type and subtype to merge
+         * @param files the runs of every file, where `files[i]` holds the items of file number `i`
+         * @return      the merged columns for the type
+         */
+        inline TypeColumns mergeType(const TypeSubtype& type, const std::vector<FileRuns>& files) {
+            std::vector<Run> runs;
+            size_t count = 0;
+
+            for (size_t fileno = 0; fileno < files.size(); fileno++) {
+                auto& file = files[fileno];
+
+                auto found = std::lower_bound(file.types.begin(), file.types.end(), type);
+                if (found != file.types.end() && *found == type) {
+                    size_t i = std::distance(file.types.begin(), found);
+                    runs.push_back(Run{file.items.data() + file.starts[i],
+                                       file.items.data() + file.starts[i + 1],
+                                       uint32_t(fileno)});
+                    count += file.starts[i + 1] - file.starts[i];
+                }
+            }
+
+            std::vector<uint64_t> timestamps(count);
+            std::vector<uint64_t> offsets(count);
+            std::vector<uint32_t> lengths(count);
+            std::vector<uint32_t> filenos(count);
+            size_t position = 0;
+
+            auto take = [&](Run& run) {
+                timestamps[position] = run.begin->timestamp;
+                offsets[position]    = run.begin->offset;
+                lengths[position]    = run.begin->length;
+                filenos[position]    = run.fileno;
+                position++;
+                run.begin++;
+            };
+
+            // Keep the runs in a min heap by their next item. Files usually cover separate stretches of time, so
+            // rather than going back to the heap for every item, take from the first run for as long as it stays
+            // ahead of the next best run.
+            auto later = [](const Run& a, const Run& b) { return after(a, b); };
+            std::make_heap(runs.begin(), runs.end(), later);
+
+            while (!runs.empty()) {
+                std::pop_heap(runs.begin(), runs.end(), later);
+                Run& run = runs.back();
+
+                if (runs.size() == 1) {
+                    while (run.begin != run.end) {
+                        take(run);
+                    }
+                }
+                else {
+                    const Run& next = runs.front();
+                    do {
+                        take(run);
+                    } while (run.begin != run.end && !after(run, next));
+                }
+
+                if (run.begin == run.end) {
+                    runs.pop_back();
+                }
+                else {
+                    std::push_heap(runs.begin(), runs.end(), later);
+                }
+            }
+
+            TypeColumns columns;
+            columns.type       = type;
+            columns.timestamps = Column<uint64_t>(std::move(timestamps));
+            columns.offsets    = Column<uint64_t>(std::move(offsets));
+            columns.lengths    = Column<uint32_t>(std::move(lengths));
+            columns.filenos    = Column<uint32_t>(std::move(filenos));
+            return columns;
+        }
+
+    }  // namespace merge
+}  // namespace nbs
+
+#endif  // NBS_INDEXMERGE_HPP
@@ -75,6 +75,29 @@ namespace nbs {
         if (packet.payload == nullptr) {
             jsPacket.Set("payload", env.Undefined());
         }
+        else if (packet.owner) {
+            // The owner is either a memory map (with the `zeroCopy` option) or a heap copy made off the JS thread by
+            // an async read. Only the maps are read only, where JS writes to this Buffer segfault rather than throw
+            // (mio has no writable private maps, and the typings warn about it); heap copies can be written freely.
+            // Some runtimes don't allow Buffers of external memory, so fall back to copying the payload there
+            auto owner = new std::shared_ptr<const void>(packet.owner);
+            napi_value payload;
+            napi_status status = napi_create_external_buffer(
+                env,
+                packet.length,
+                packet.payload,
+                [](napi_env, void*, void* hint) { delete static_cast<std::shared_ptr<const void>*>(hint); },
+                owner,
+                &payload);
+
+            if (status == napi_ok) {
+                jsPacket.Set("payload", payload);
+            }
+            else {
+                delete owner;
+                jsPacket.Set("payload", Napi::Buffer<uint8_t>::Copy(env, packet.payload, packet.length));
+            }
+        }
         else {
             jsPacket.Set("payload", Napi::Buffer<uint8_t>::Copy(env, packet.payload, packet.length));
         }
@@ -2,6 +2,7 @@
 #define NBS_PACKET_HPP
 
 #include <cstdint>
+#include <memory>
 
 #include "Hash.hpp"
 #include "Timestamp.hpp"
@@ -25,6 +26,9 @@ namespace nbs {
         /// The length of the payload in bytes (excluding the header)
         uint32_t length;
 
+        /// Keeps the memory the payload points into alive. If set, the payload is given to JS without copying it.
+        std::shared_ptr<const void> owner;
+
         /**
          * Convert the given JS value to a Packet instance.
          *
@@ -40,6 +44,9 @@ namespace nbs {
         /**
          * Create a JS packet from a Packet instance.
          *
+         * The payload is copied into a new Buffer, unless the packet has an `owner`. In that case the Buffer points
+         * straight at the payload and holds a reference to the owner until it is garbage collected.
+         *
          * @param packet Packet to convert to a JS packet.
          * @param env    JS environment.
          * @return       JS Object containing keys `timestamp`, `type`, `subtype`, and `payload`
@@ -0,0 +1,149 @@
+#ifndef NBS_PACKETCACHE_HPP
+#define NBS_PACKETCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <napi.h>
+#include <unordered_map>
+
+#include "IndexItem.hpp"
+
+namespace nbs {
+
+    /**
+     * Keeps the most recently read JS packets, so reading the same packets again (such as when scrubbing back and
+     * forth through a recording) returns the packets that were already built rather than building them again.
+     *
+     * Packets are keyed by where they are in the nbs files, and the least recently used packets are dropped to keep
+     * the total size of the cached packets within a budget. Cached packets are shared by every read that returns them,
+     * so changing one changes what later reads return.
+     */
+    class PacketCache {
+    public:
+        /// Roughly how many bytes each cached packet takes on top of its payload
+        static constexpr size_t PACKET_OVERHEAD = 128;
+
+        /**
+         * Create a cache
+         *
+         * @param budget the most bytes of packets to keep, or 0 to keep none
+         */
+        explicit PacketCache(const size_t& budget = 0) : budget(budget) {}
+
+        PacketCache(const PacketCache&)            = delete;
+        PacketCache& operator=(const PacketCache&) = delete;
+
+        /// Check if the cache keeps any packets
+        bool enabled() const {
+            return this->budget > 0;
+        }
+
+        /// Get the cached packet for the given index item and mark it as the most recently used, or get an empty value
+        /// if it isn't cached
+        Napi::Value get(const IndexItemFile& item) {
+            auto found = this->positions.find(Key{item.fileno, item.item.offset});
+            if (found == this->positions.end()) {
+                this->misses++;
+                return Napi::Value();
+            }
+
+            this->hits++;
+            this->entries.splice(this->entries.begin(), this->entries, found->second);
+            return found->second->packet.Value();
+        }
+
+        /**
+         * Add the packet for the given index item, dropping the least recently used packets to make room for it
+         *
+         * @param item   the index item the packet was read for
+         * @param packet the JS packet
+         */
+        void put(const IndexItemFile& item, const Napi::Value& packet) {
+            const size_t bytes = item.item.length + PACKET_OVERHEAD;
+            if (bytes > this->budget) {
+                return;
+            }
+
+            Key key{item.fileno, item.item.offset};
+            if (this->positions.count(key) != 0) {
+                return;
+            }
+
+            while (this->used + bytes > this->budget) {
+                this->used -= this->entries.back().bytes;
+                this->positions.erase(this->entries.back().key);
+                this->entries.pop_back();
+            }
+
+            this->entries.emplace_front();
+            this->entries.front().key    = key;
+            this->entries.front().packet = Napi::Persistent(packet.As<Napi::Object>());
+            this->entries.front().bytes  = bytes;
+            this->positions[key]         = this->entries.begin();
+            this->used += bytes;
+        }
+
+        /// Drop every cached packet
+        void clear() {
+            this->entries.clear();
+            this->positions.clear();
+            this->used = 0;
+        }
+
+        /// Get the number of cached packets
+        size_t size() const {
+            return this->entries.size();
+        }
+
+        /// Get the number of bytes of cached packets, counting the payloads and an estimate of their overhead
+        size_t bytes() const {
+            return this->used;
+        }
+
+        /// The most bytes of packets to keep
+        const size_t budget;
+
+        /// The number of reads that found their packet in the cache
+        uint64_t hits = 0;
+
+        /// The number of reads that didn't
+        uint64_t misses = 0;
+
+    private:
+        /// Where a packet is in the nbs files
+        struct Key {
+            int fileno;
+            uint64_t offset;
+
+            bool operator==(const Key& other) const {
+                return this->fileno == other.fileno && this->offset == other.offset;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const {
+                return std::hash<uint64_t>()(key.offset * 31 + uint64_t(key.fileno));
+            }
+        };
+
+        struct Entry {
+            Key key{};
+            Napi::ObjectReference packet;
+            size_t bytes = 0;
+        };
+
+        /// The cached packets, from the most recently used to the least
+        std::list<Entry> entries;
+
+        /// The position of each cached packet in `entries`
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> positions;
+
+        /// The number of bytes of cached packets
+        size_t used = 0;
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_PACKETCACHE_HPP
@@ -0,0 +1,78 @@
+#ifndef NBS_PARALLEL_HPP
+#define NBS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace nbs {
+    namespace parallel {
+
+        /// Get the number of worker threads to use for a job with the given number of tasks
+        inline size_t threadCount(const size_t& tasks) {
+            // hardware_concurrency() may return 0 if the value is not computable
+            size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+            return std::min(cores, tasks);
+        }
+
+        /**
+         * Run `fn(i)` for every `i` in [0, count) using a bounded pool of worker threads.
+         *
+         * Tasks are handed out to the workers in order as they become free, so long running tasks don't hold up
+         * the rest. If any task throws, the remaining tasks are still run and the exception from the task with
+         * the lowest index is rethrown on the calling thread once all workers have finished.
+         *
+         * @param count the number of tasks to run
+         * @param fn    the function to run for each task, called with the task index
+         */
+        template <typename F>
+        void forEach(const size_t& count, F&& fn) {
+            const size_t workers = threadCount(count);
+
+            // Run inline when there's nothing to gain from spawning threads
+            if (workers <= 1) {
+                for (size_t i = 0; i < count; i++) {
+                    fn(i);
+                }
+                return;
+            }
+
+            std::atomic<size_t> next{0};
+            std::vector<std::exception_ptr> errors(count);
+
+            auto work = [&] {
+                for (size_t i = next++; i < count; i = next++) {
+                    try {
+                        fn(i);
+                    }
+                    catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            };
+
+            // The calling thread does its share of the work too
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < workers; i++) {
+                threads.emplace_back(work);
+            }
+            work();
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            for (auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+    }  // namespace parallel
+}  // namespace nbs
+
+#endif  // NBS_PARALLEL_HPP
@@ -0,0 +1,251 @@
+#include "Scanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include "Parallel.hpp"
+#include "third-party/mio/mmap.hpp"
+#include "third-party/zstr/zstr.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define NBS_SCANNER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define NBS_SCANNER_NEON
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace nbs {
+    namespace scanner {
+
+        /// The bytes of the ☢ symbol at the start of each packet
+        constexpr uint8_t MARKER[3] = {0xE2, 0x98, 0xA2};
+
+        /// The size of the packet header: ☢ symbol, packet length, timestamp and type hash
+        constexpr uint64_t HEADER_SIZE = 3 + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t);
+
+        /// The size of the chunks the file is split into for searching in parallel
+        constexpr uint64_t CHUNK_SIZE = 8 * 1024 * 1024;
+
+        /// Check if there is a packet header symbol at the given position
+        inline bool isMarker(const uint8_t* data, const uint64_t& size, const uint64_t& position) {
+            return position + 3 <= size && data[position] == MARKER[0] && data[position + 1] == MARKER[1]
+                   && data[position + 2] == MARKER[2];
+        }
+
+        /// Get the index of the lowest set bit in a non-zero mask
+        inline int lowestBit(const uint32_t& mask) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return int(index);
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        /// Find the positions in [begin, end) where a packet header symbol starts, appending them to `positions`
+        void findMarkers(const uint8_t* data,
+                         const uint64_t& size,
+                         const uint64_t& begin,
+                         const uint64_t& end,
+                         std::vector<uint64_t>& positions) {
+            uint64_t position = begin;
+
+#if defined(NBS_SCANNER_SSE2)
+            // Compare 16 positions at a time against each byte of the symbol (the loads at +1 and +2 need two extra
+            // bytes, which is why this stops 18 bytes before the end of the file)
+            const __m128i first  = _mm_set1_epi8(char(MARKER[0]));
+            const __m128i second = _mm_set1_epi8(char(MARKER[1]));
+            const __m128i third  = _mm_set1_epi8(char(MARKER[2]));
+
+            for (; position < end && position + 18 <= size; position += 16) {
+                const __m128i* block = reinterpret_cast<const __m128i*>(data + position);
+
+                __m128i matches = _mm_and_si128(
+                    _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(block), first),
+                                  _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 1)),
+                                                 second)),
+                    _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position + 2)), third));
+
+                uint32_t mask = uint32_t(_mm_movemask_epi8(matches));
+                while (mask != 0) {
+                    uint64_t match = position + lowestBit(mask);
+                    if (match < end) {
+                        positions.push_back(match);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+#elif defined(NBS_SCANNER_NEON)
+            // NEON has no movemask, so only check 16 positions one by one when any of them matched
+            const uint8x16_t first  = vdupq_n_u8(MARKER[0]);
+            const uint8x16_t second = vdupq_n_u8(MARKER[1]);
+            const uint8x16_t third  = vdupq_n_u8(MARKER[2]);
+
+            for (; position < end && position + 18 <= size; position += 16) {
+                uint8x16_t matches = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(data + position), first),
+                                                       vceqq_u8(vld1q_u8(data + position + 1), second)),
+                                              vceqq_u8(vld1q_u8(data + position + 2), third));
+
+                if (vmaxvq_u8(matches) != 0) {
+                    for (uint64_t match = position; match < position + 16 && match < end; match++) {
+                        if (isMarker(data, size, match)) {
+                            positions.push_back(match);
+                        }
+                    }
+                }
+            }
+#else
+            // Without SIMD let memchr find candidates for the first byte
+            while (position < end && position + 3 <= size) {
+                const void* found = std::memchr(data + position, MARKER[0], end - position);
+                if (found == nullptr) {
+                    return;
+                }
+                position = static_cast<const uint8_t*>(found) - data;
+                if (isMarker(data, size, position)) {
+                    positions.push_back(position);
+                }
+                position++;
+            }
+#endif
+
+            // Check whatever is left over one position at a time
+            for (; position < end; position++) {
+                if (isMarker(data, size, position)) {
+                    positions.push_back(position);
+                }
+            }
+        }
+
+        std::vector<IndexItem> scan(const std::string& nbsPath) {
+            struct stat buffer {};
+            if (stat(nbsPath.c_str(), &buffer) != 0) {
+                throw std::runtime_error("nbs file not found: " + nbsPath);
+            }
+
+            std::vector<IndexItem> items;
+
+            // An empty file has no packets (and can't be memory mapped)
+            if (buffer.st_size == 0) {
+                return items;
+            }
+
+            mio::basic_mmap_source<uint8_t> map(nbsPath, 0, mio::map_entire_file);
+            const uint8_t* data = map.data();
+            const uint64_t size = map.size();
+
+            // Find every packet header symbol, searching each chunk of the file in parallel
+            const uint64_t chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            std::vector<std::vector<uint64_t>> chunkMarkers(chunks);
+            parallel::forEach(chunks, [&](const size_t& chunk) {
+                findMarkers(data,
+                            size,
+                            chunk * CHUNK_SIZE,
+                            std::min(size, (chunk + 1) * CHUNK_SIZE),
+                            chunkMarkers[chunk]);
+            });
+
+            std::vector<uint64_t> markers;
+            for (auto& chunk : chunkMarkers) {
+                markers.insert(markers.end(), chunk.begin(), chunk.end());
+            }
+
+            // Follow the packets from one header to the next. Payloads can contain the header symbol too, so the
+            // markers found above are only used to find the next packet when following the chain breaks.
+            uint64_t position = markers.empty() ? size : markers.front();
+            while (position < size) {
+                if (position + HEADER_SIZE <= size) {
+                    uint32_t length = 0;
+                    std::memcpy(&length, data + position + 3, sizeof(uint32_t));
+
+                    // The length counts the timestamp, hash, and payload after the length field
+                    const uint64_t packetEnd = position + 3 + sizeof(uint32_t) + uint64_t(length);
+
+                    // A packet is only trusted if it is complete and is followed by another packet or the end of file
+                    if (length >= sizeof(uint64_t) * 2 && packetEnd <= size
+                        && (packetEnd == size || isMarker(data, size, packetEnd))) {
+                        uint64_t timestampMicros = 0;
+                        IndexItem item{};
+                        std::memcpy(&timestampMicros, data + position + 7, sizeof(uint64_t));
+                        std::memcpy(&item.type, data + position + 15, sizeof(uint64_t));
+                        item.subtype   = 0;
+                        item.timestamp = timestampMicros * 1000;
+                        item.offset    = position;
+                        item.length    = uint32_t(packetEnd - position);
+                        items.push_back(item);
+
+                        position = packetEnd;
+                        continue;
+                    }
+                }
+
+                // Resynchronise at the next header symbol after this broken packet
+                auto next = std::upper_bound(markers.begin(), markers.end(), position);
+                position  = next == markers.end() ? size : *next;
+            }
+
+            return items;
+        }
+
+        uint64_t readPackets(const uint8_t* data,
+                             const uint64_t& size,
+                             const uint64_t& offset,
+                             std::vector<IndexItem>& items) {
+            uint64_t position = 0;
+
+            // Stop when there aren't enough bytes left to tell if a packet starts here
+            while (position + 3 <= size) {
+                if (isMarker(data, size, position)) {
+                    if (position + HEADER_SIZE > size) {
+                        break;
+                    }
+
+                    uint32_t length = 0;
+                    std::memcpy(&length, data + position + 3, sizeof(uint32_t));
+
+                    if (length >= sizeof(uint64_t) * 2) {
+                        const uint64_t packetEnd = position + 3 + sizeof(uint32_t) + uint64_t(length);
+
+                        // Wait for the rest of the packet to be written
+                        if (packetEnd > size) {
+                            break;
+                        }
+
+                        uint64_t timestampMicros = 0;
+                        IndexItem item{};
+                        std::memcpy(&timestampMicros, data + position + 7, sizeof(uint64_t));
+                        std::memcpy(&item.type, data + position + 15, sizeof(uint64_t));
+                        item.subtype   = 0;
+                        item.timestamp = timestampMicros * 1000;
+                        item.offset    = offset + position;
+                        item.length    = uint32_t(packetEnd - position);
+                        items.push_back(item);
+
+                        position = packetEnd;
+                        continue;
+                    }
+                }
+
+                // This isn't a packet, so skip ahead to the next byte that could start one
+                const void* found = std::memchr(data + position + 1, MARKER[0], size - position - 1);
+                position          = found == nullptr ? size : static_cast<const uint8_t*>(found) - data;
+            }
+
+            return position;
+        }
+
+        void writeIndex(const std::string& idxPath, const std::vector<IndexItem>& items) {
+            zstr::ofstream output(idxPath, std::ios_base::binary);
+            output.write(reinterpret_cast<const char*>(items.data()), int64_t(items.size() * sizeof(IndexItem)));
+        }
+
+    }  // namespace scanner
+}  // namespace nbs
@@ -0,0 +1,57 @@
+#ifndef NBS_SCANNER_HPP
+#define NBS_SCANNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IndexItem.hpp"
+
+namespace nbs {
+    namespace scanner {
+
+        /**
+         * Build the index items for an nbs file by scanning its packets, for files that don't have an index file.
+         *
+         * The file is split into chunks which are searched in parallel for the ☢ packet header, and the packets are
+         * then followed from header to header using their lengths. Only packets that are complete and are followed by
+         * another packet header (or the end of the file) are kept, so truncated or corrupted packets are skipped.
+         *
+         * The nbs file itself doesn't store packet subtypes, so all scanned items have a subtype of 0, and their
+         * timestamps are the (microsecond) timestamps from the packet headers.
+         *
+         * @param nbsPath the path of the nbs file to scan
+         * @return        the index items for the packets found in the file, in file order
+         */
+        std::vector<IndexItem> scan(const std::string& nbsPath);
+
+        /**
+         * Read the complete packets from a block of bytes that were appended to an nbs file, such as one that is still
+         * being written. Reading stops at the first packet that isn't complete yet, so it can be read again once the
+         * rest of it has been written. Bytes that aren't part of a packet are skipped.
+         *
+         * As with scan(), the items have a subtype of 0 and the timestamps from the packet headers.
+         *
+         * @param data   the appended bytes
+         * @param size   the number of appended bytes
+         * @param offset the position of the first appended byte in the nbs file
+         * @param items  the index items for the packets read are appended to this
+         * @return       the number of bytes read, which is where the next block should start
+         */
+        uint64_t readPackets(const uint8_t* data,
+                             const uint64_t& size,
+                             const uint64_t& offset,
+                             std::vector<IndexItem>& items);
+
+        /**
+         * Write the given index items to a gzipped index file, in the same format as written by the Encoder.
+         *
+         * @param idxPath the path of the index file to write
+         * @param items   the index items to write
+         */
+        void writeIndex(const std::string& idxPath, const std::vector<IndexItem>& items);
+
+    }  // namespace scanner
+}  // namespace nbs
+
+#endif  // NBS_SCANNER_HPP
@@ -0,0 +1,90 @@
+#ifndef NBS_SEARCHSTATS_HPP
+#define NBS_SEARCHSTATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace nbs {
+
+    /// The ways the timestamps of a type can be searched
+    enum class SearchStrategy {
+        /// A binary search over the whole timestamp column
+        BINARY,
+
+        /// A SearchTree over the timestamp column
+        TREE,
+
+        /// A TimestampModel prediction, then a binary search within its error bound
+        INTERPOLATION,
+
+        /// A binary search over the blocks of CompactColumns, then a scan of one block
+        COMPACT,
+    };
+
+    /// Counts the timestamp searches of a type and the timestamps they probed. Counts are relaxed atomics, so they
+    /// can be updated from concurrent searches.
+    struct SearchStats {
+        std::atomic<uint64_t> searches{0};
+        std::atomic<uint64_t> probes{0};
+
+        /// Whether searches are counted. Off unless asked for, since every search would otherwise write to counters
+        /// shared by every thread reading the index.
+        bool enabled = false;
+
+        SearchStats() = default;
+
+        SearchStats(const SearchStats& other)
+            : searches(other.searches.load(std::memory_order_relaxed))
+            , probes(other.probes.load(std::memory_order_relaxed))
+            , enabled(other.enabled) {}
+
+        SearchStats& operator=(const SearchStats& other) {
+            searches.store(other.searches.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            probes.store(other.probes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            enabled = other.enabled;
+            return *this;
+        }
+
+        /// Count a search that probed the given number of timestamps, if searches are counted
+        void record(const size_t& probed) {
+            if (!enabled) {
+                return;
+            }
+            searches.fetch_add(1, std::memory_order_relaxed);
+            probes.fetch_add(probed, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Find the first timestamp in [begin, end) greater than the given timestamp with a binary search, counting the
+     * timestamps it probes.
+     *
+     * @param begin     the first timestamp to search, sorted in ascending order
+     * @param end       one past the last timestamp to search
+     * @param timestamp the timestamp to search for
+     * @param probes    incremented for each timestamp probed
+     * @return          the first timestamp greater than the given timestamp, or `end` if there is none
+     */
+    inline const uint64_t* probedUpperBound(const uint64_t* begin,
+                                            const uint64_t* end,
+                                            const uint64_t& timestamp,
+                                            size_t& probes) {
+        size_t count = end - begin;
+        while (count > 0) {
+            const size_t half = count / 2;
+            probes++;
+            if (begin[half] <= timestamp) {
+                begin += half + 1;
+                count -= half + 1;
+            }
+            else {
+                count = half;
+            }
+        }
+        return begin;
+    }
+
+}  // namespace nbs
+
+#endif  // NBS_SEARCHSTATS_HPP
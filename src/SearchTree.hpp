@@ -0,0 +1,147 @@
+#ifndef NBS_SEARCHTREE_HPP
+#define NBS_SEARCHTREE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "SearchStats.hpp"
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #if defined(_M_X64) || defined(_M_IX86)
+        #include <xmmintrin.h>
+    #endif
+#endif
+
+namespace nbs {
+
+    /**
+     * A cache friendly search structure over a sorted column of timestamps, for types with so many items that a
+     * binary search over the column misses the cache at almost every step.
+     *
+     * The column is split into blocks of BLOCK_SIZE timestamps, and the first timestamp of each block is stored in an
+     * Eytzinger (breadth first) layout, so the keys near the top of the tree share cache lines and the children of a
+     * key are next to each other. The search prefetches the keys a few levels below the current one, then finishes
+     * with a binary search within a single block of the column.
+     */
+    class SearchTree {
+    public:
+        /// The number of timestamps in each block of the column
+        static constexpr size_t BLOCK_SIZE = 16;
+
+        SearchTree() = default;
+
+        /**
+         * Build the tree for the given sorted timestamps
+         *
+         * @param timestamps the timestamps to search, sorted in ascending order
+         * @param count      the number of timestamps
+         */
+        SearchTree(const uint64_t* timestamps, const size_t& count) {
+            const size_t blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+            // The tree is 1 indexed, so the children of key k are keys 2k and 2k + 1
+            keys.resize(blocks + 1);
+            this->blocks.resize(blocks + 1);
+
+            size_t next = 0;
+            fill(timestamps, 1, next);
+        }
+
+        /// Check if the tree has been built
+        bool empty() const {
+            return keys.size() <= 1;
+        }
+
+        /**
+         * Get the position of the first timestamp greater than the given timestamp
+         *
+         * @param timestamps the timestamps the tree was built from
+         * @param count      the number of timestamps
+         * @param timestamp  the timestamp to search for
+         * @param probes     incremented for each key and timestamp probed
+         * @return           the position of the first greater timestamp, or `count` if there is none
+         */
+        size_t upperBound(const uint64_t* timestamps,
+                          const size_t& count,
+                          const uint64_t& timestamp,
+                          size_t& probes) const {
+            const size_t size = keys.size() - 1;
+            const uint64_t* tree = keys.data();
+
+            // Descend the tree, going right whenever the key is not greater than the timestamp. Eight keys fill a
+            // cache line, so this fetches the descendants three levels down while we work on this level.
+            size_t k = 1;
+            while (k <= size) {
+                prefetch(tree + std::min(k * 8, size));
+                k = 2 * k + size_t(tree[k] <= timestamp);
+                probes++;
+            }
+
+            // Undo the right turns taken after the last left turn, which leaves the first key greater than the
+            // timestamp, or 0 if every key is less than or equal to it
+            k >>= trailingOnes(k) + 1;
+
+            // Everything before the first block whose first timestamp is greater can be skipped
+            const size_t block = k == 0 ? size : this->blocks[k];
+            if (block == 0) {
+                return 0;
+            }
+
+            const uint64_t* begin = timestamps + (block - 1) * BLOCK_SIZE;
+            const uint64_t* end   = timestamps + std::min(block * BLOCK_SIZE, count);
+            return std::distance(timestamps, probedUpperBound(begin, end, timestamp, probes));
+        }
+
+    private:
+        /// The first timestamp of each block, in Eytzinger order starting from position 1
+        std::vector<uint64_t> keys;
+
+        /// The block number of each key in `keys`
+        std::vector<uint32_t> blocks;
+
+        /// Fill the subtree rooted at `k` with the keys of the blocks from `next` onwards, with an in order traversal
+        void fill(const uint64_t* timestamps, const size_t& k, size_t& next) {
+            if (k < keys.size()) {
+                fill(timestamps, 2 * k, next);
+                keys[k]   = timestamps[next * BLOCK_SIZE];
+                blocks[k] = uint32_t(next);
+                next++;
+                fill(timestamps, 2 * k + 1, next);
+            }
+        }
+
+        /// Hint that the memory at the given address will be read soon
+        static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+            (void) address;
+#endif
+        }
+
+        /// Count the number of consecutive set bits at the bottom of the given value
+        static int trailingOnes(const size_t& value) {
+            const uint64_t inverted = ~uint64_t(value);
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, inverted);
+            return int(index);
+#elif defined(_MSC_VER)
+            int count = 0;
+            for (uint64_t bits = inverted; (bits & 1) == 0; bits >>= 1) {
+                count++;
+            }
+            return count;
+#else
+            return __builtin_ctzll(inverted);
+#endif
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_SEARCHTREE_HPP
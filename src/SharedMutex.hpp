@@ -0,0 +1,77 @@
+#ifndef NBS_SHAREDMUTEX_HPP
+#define NBS_SHAREDMUTEX_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace nbs {
+
+    /**
+     * A mutex that can be held by many readers at once, or by one writer.
+     *
+     * This stands in for std::shared_timed_mutex, which isn't available on macOS before 10.12. It has the same
+     * interface, so it works with std::unique_lock and std::shared_lock. Waiting writers go first, so readers that
+     * keep arriving can't hold a writer off forever.
+     */
+    class SharedMutex {
+    public:
+        SharedMutex() = default;
+
+        SharedMutex(const SharedMutex&)            = delete;
+        SharedMutex& operator=(const SharedMutex&) = delete;
+
+        /// Wait until there are no readers or writers, and then hold the mutex as the writer
+        void lock() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->waitingWriters++;
+            this->changed.wait(lock, [this] { return !this->writing && this->readers == 0; });
+            this->waitingWriters--;
+            this->writing = true;
+        }
+
+        /// Release the mutex held as the writer
+        void unlock() {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->writing = false;
+            }
+            this->changed.notify_all();
+        }
+
+        /// Wait until there are no writers, and then hold the mutex as one of the readers
+        void lock_shared() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->changed.wait(lock, [this] { return !this->writing && this->waitingWriters == 0; });
+            this->readers++;
+        }
+
+        /// Release the mutex held as one of the readers
+        void unlock_shared() {
+            bool last = false;
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                last = --this->readers == 0;
+            }
+            if (last) {
+                this->changed.notify_all();
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+
+        /// The number of readers holding the mutex
+        size_t readers = 0;
+
+        /// The number of writers waiting for the mutex
+        size_t waitingWriters = 0;
+
+        /// Whether a writer holds the mutex
+        bool writing = false;
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_SHAREDMUTEX_HPP
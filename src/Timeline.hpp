@@ -0,0 +1,430 @@
+#ifndef NBS_TIMELINE_HPP
+#define NBS_TIMELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "IndexItem.hpp"
+#include "TypeColumns.hpp"
+#include "TypeIdMap.hpp"
+
+namespace nbs {
+
+    /// A reference to one index item, as the id of its type and its position in that type's columns
+    struct TimelineEntry {
+        TypeId type;
+        uint32_t position;
+    };
+
+    /// Check if two index items are for the same packet
+    inline bool samePacket(const IndexItemFile& a, const IndexItemFile& b) {
+        return a.fileno == b.fileno && a.item.offset == b.item.offset;
+    }
+
+    /**
+     * Every index item of every type, in timestamp order, for walking the packets of all types in the order they were
+     * recorded. Items with equal timestamps are ordered by type id, then by their position within their type.
+     *
+     * Each entry is only a reference into the per-type columns, so the timeline costs 8 bytes per item on top of the
+     * index. It refers to the columns it was built from, and has to be rebuilt if they change.
+     */
+    class Timeline {
+    public:
+        Timeline() = default;
+
+        /**
+         * Build the timeline by merging the timestamps of every type
+         *
+         * @param columns the columns of each type, indexed by type id
+         */
+        explicit Timeline(std::vector<const TypeColumns*> columns) : columns(std::move(columns)), timelineId(nextId()) {
+            struct Head {
+                uint64_t timestamp;
+                TimelineEntry entry;
+            };
+
+            // Keep the next item of each type in a min heap, ordered the same way as the timeline
+            auto later = [](const Head& a, const Head& b) {
+                return a.timestamp != b.timestamp ? a.timestamp > b.timestamp : a.entry.type > b.entry.type;
+            };
+
+            // Read each type's timestamps a chunk at a time, which is much faster than one at a time for packed columns
+            constexpr size_t CHUNK_SIZE = 256;
+            std::vector<std::vector<uint64_t>> chunks(this->columns.size());
+            auto timestampAt = [&](const TimelineEntry& entry) {
+                auto& chunk = chunks[entry.type];
+                if (entry.position % CHUNK_SIZE == 0) {
+                    auto& type = *this->columns[entry.type];
+                    chunk.clear();
+                    type.forEach(entry.position,
+                                 std::min<size_t>(entry.position + CHUNK_SIZE, type.size()),
+                                 [&](const IndexItemFile& itemFile) { chunk.push_back(itemFile.item.timestamp); });
+                }
+                return chunk[entry.position % CHUNK_SIZE];
+            };
+
+            std::vector<Head> heads;
+            size_t count = 0;
+            for (size_t id = 0; id < this->columns.size(); id++) {
+                auto& type = *this->columns[id];
+                if (type.size() > (std::numeric_limits<uint32_t>::max)()) {
+                    throw std::runtime_error("too many packets of a single type to build a timeline");
+                }
+                if (type.size() > 0) {
+                    TimelineEntry first{TypeId(id), 0};
+                    heads.push_back(Head{timestampAt(first), first});
+                    count += type.size();
+                }
+            }
+            std::make_heap(heads.begin(), heads.end(), later);
+
+            entries.reserve(count);
+            while (!heads.empty()) {
+                std::pop_heap(heads.begin(), heads.end(), later);
+                Head& head       = heads.back();
+                const size_t end = this->columns[head.entry.type]->size();
+
+                // Take items from this type for as long as it stays ahead of every other type, which saves going back
+                // to the heap for every item when types are recorded in bursts
+                do {
+                    entries.push_back(head.entry);
+                    head.entry.position++;
+                    if (head.entry.position < end) {
+                        head.timestamp = timestampAt(head.entry);
+                    }
+                } while (head.entry.position < end && (heads.size() == 1 || !later(head, heads.front())));
+
+                if (head.entry.position == end) {
+                    heads.pop_back();
+                }
+                else {
+                    std::push_heap(heads.begin(), heads.end(), later);
+                }
+            }
+        }
+
+        /// Get the number of items in the timeline
+        size_t size() const {
+            return entries.size();
+        }
+
+        /// Get the entry at the given position in the timeline
+        const TimelineEntry& operator[](const size_t& position) const {
+            return entries[position];
+        }
+
+        /// Get the timestamp of the given entry
+        uint64_t timestamp(const TimelineEntry& entry) const {
+            return columns[entry.type]->timestamp(entry.position);
+        }
+
+        /// Get the index item the given entry refers to
+        IndexItemFile item(const TimelineEntry& entry) const {
+            return columns[entry.type]->item(entry.position);
+        }
+
+        /// Get the position of the first entry with a timestamp at or after the given timestamp
+        size_t lowerBound(const uint64_t& timestamp) const {
+            return std::distance(entries.begin(),
+                                 std::partition_point(entries.begin(), entries.end(), [&](const TimelineEntry& entry) {
+                                     return this->timestamp(entry) < timestamp;
+                                 }));
+        }
+
+        /// Get the position of the first entry that comes after the given item of the given type, which need not be
+        /// in this timeline. Its position within its type may have changed since, such as when items with earlier
+        /// timestamps have been added, so it is found among the items with the same timestamp by its packet.
+        size_t upperBound(const TypeId& type, const IndexItemFile& after) const {
+            const uint64_t timestamp = after.item.timestamp;
+
+            auto begin = std::partition_point(entries.begin(), entries.end(), [&](const TimelineEntry& entry) {
+                const uint64_t entryTimestamp = this->timestamp(entry);
+                return entryTimestamp != timestamp ? entryTimestamp < timestamp : entry.type < type;
+            });
+            auto end = std::partition_point(begin, entries.end(), [&](const TimelineEntry& entry) {
+                return entry.type == type && this->timestamp(entry) == timestamp;
+            });
+
+            for (auto it = begin; it != end; ++it) {
+                if (samePacket(this->item(*it), after)) {
+                    return std::distance(entries.begin(), it) + 1;
+                }
+            }
+            return std::distance(entries.begin(), end);
+        }
+
+        /// Get a number that identifies this timeline, which is different for every timeline that is built
+        uint64_t id() const {
+            return timelineId;
+        }
+
+    private:
+        /// The columns of each type, indexed by type id
+        std::vector<const TypeColumns*> columns;
+
+        /// Every item, in timestamp order
+        std::vector<TimelineEntry> entries;
+
+        /// Identifies this timeline
+        uint64_t timelineId = 0;
+
+        /// Get a new timeline id
+        static uint64_t nextId() {
+            static std::atomic<uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * A position in a Timeline that steps through the items of every type in timestamp order.
+     *
+     * The cursor sits between two items: `next()` returns the item after it and moves past it, and `prev()` returns
+     * the item before it and moves back over it. It remembers the last item it passed, so if the timeline is rebuilt
+     * (such as after packets are added to the index) it carries on from the same place in the new timeline.
+     */
+    class TimelineCursor {
+    public:
+        /// Get the next item and move past it, or return false if there are no more
+        bool next(const Timeline& timeline, IndexItemFile& item) {
+            sync(timeline);
+
+            if (position == timeline.size()) {
+                return false;
+            }
+
+            item = timeline.item(timeline[position]);
+            position++;
+            remember(timeline);
+            return true;
+        }
+
+        /// Get the previous item and move back over it, or return false if there are none
+        bool prev(const Timeline& timeline, IndexItemFile& item) {
+            sync(timeline);
+
+            if (position == 0) {
+                return false;
+            }
+
+            position--;
+            item = timeline.item(timeline[position]);
+            remember(timeline);
+            return true;
+        }
+
+        /// Move the cursor so the next item is the first one at or after the given timestamp
+        void seek(const Timeline& timeline, const uint64_t& timestamp) {
+            position   = timeline.lowerBound(timestamp);
+            timelineId = timeline.id();
+            remember(timeline);
+        }
+
+    private:
+        /// The position of the next item in the timeline
+        size_t position = 0;
+
+        /// The id of the timeline `position` is in
+        uint64_t timelineId = 0;
+
+        /// Whether there is an item before the cursor, and which one it is
+        bool hasBefore    = false;
+        TypeId beforeType = 0;
+        IndexItemFile beforeItem{};
+
+        /// Remember the item before the cursor, so it can find its place again in a rebuilt timeline
+        void remember(const Timeline& timeline) {
+            hasBefore = position > 0;
+            if (hasBefore) {
+                beforeType = timeline[position - 1].type;
+                beforeItem = timeline.item(timeline[position - 1]);
+            }
+        }
+
+        /// Find the cursor's place in the given timeline, if it was positioned in a different one
+        void sync(const Timeline& timeline) {
+            if (timeline.id() != timelineId) {
+                position   = hasBefore ? timeline.upperBound(beforeType, beforeItem) : 0;
+                timelineId = timeline.id();
+            }
+        }
+    };
+
+    /**
+     * A position among the items of some of the types that steps through them in timestamp order, in the same order
+     * as a Timeline, by merging the types' own columns.
+     *
+     * Each step compares the next (or previous) item of each of the types, so it takes time proportional to the
+     * number of types, however many items of other types there are in between. Stepping through a rare type in a
+     * busy recording with a TimelineCursor would have to skip over every other item on the way. The timeline isn't
+     * needed either, so it is never built for these cursors.
+     *
+     * As with a TimelineCursor, the cursor remembers the last item it passed, so if items are added to the types it
+     * carries on from the same place.
+     */
+    class MergeCursor {
+    public:
+        /**
+         * Create a cursor at the start of the given types
+         *
+         * @param ids the ids of the types to step through
+         */
+        explicit MergeCursor(std::vector<TypeId> ids = {})
+            : ids(std::move(ids)), positions(this->ids.size(), 0), sizes(this->ids.size(), 0) {}
+
+        /// Get the ids of the types the cursor steps through
+        const std::vector<TypeId>& typeIds() const {
+            return ids;
+        }
+
+        /**
+         * Get the next item of the cursor's types and move past it, or return false if there are no more
+         *
+         * @param columns the columns of each of the cursor's types, in the same order as typeIds()
+         * @param item    set to the next item
+         */
+        bool next(const std::vector<const TypeColumns*>& columns, IndexItemFile& item) {
+            sync(columns);
+
+            size_t best            = ids.size();
+            uint64_t bestTimestamp = 0;
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (positions[i] < columns[i]->size()) {
+                    const uint64_t timestamp = columns[i]->timestamp(positions[i]);
+                    if (best == ids.size() || timestamp < bestTimestamp
+                        || (timestamp == bestTimestamp && ids[i] < ids[best])) {
+                        best          = i;
+                        bestTimestamp = timestamp;
+                    }
+                }
+            }
+            if (best == ids.size()) {
+                return false;
+            }
+
+            item = columns[best]->item(positions[best]);
+            positions[best]++;
+
+            hasBefore  = true;
+            beforeType = ids[best];
+            beforeItem = item;
+            return true;
+        }
+
+        /**
+         * Get the previous item of the cursor's types and move back over it, or return false if there are none
+         *
+         * @param columns the columns of each of the cursor's types, in the same order as typeIds()
+         * @param item    set to the previous item
+         */
+        bool prev(const std::vector<const TypeColumns*>& columns, IndexItemFile& item) {
+            sync(columns);
+
+            size_t best = last(columns);
+            if (best == ids.size()) {
+                return false;
+            }
+
+            positions[best]--;
+            item = columns[best]->item(positions[best]);
+            remember(columns);
+            return true;
+        }
+
+        /**
+         * Move the cursor so the next item is the first one at or after the given timestamp
+         *
+         * @param columns   the columns of each of the cursor's types, in the same order as typeIds()
+         * @param timestamp the timestamp to move to
+         */
+        void seek(const std::vector<const TypeColumns*>& columns, const uint64_t& timestamp) {
+            for (size_t i = 0; i < ids.size(); i++) {
+                positions[i] = columns[i]->lowerBound(timestamp);
+                sizes[i]     = columns[i]->size();
+            }
+            remember(columns);
+        }
+
+    private:
+        /// The ids of the types to step through
+        std::vector<TypeId> ids;
+
+        /// The position of the next item of each type
+        std::vector<size_t> positions;
+
+        /// The number of items of each type when `positions` was found, to tell when items have been added
+        std::vector<size_t> sizes;
+
+        /// Whether there is an item before the cursor, and which one it is
+        bool hasBefore    = false;
+        TypeId beforeType = 0;
+        IndexItemFile beforeItem{};
+
+        /// Find which type has the item just before the cursor, or return the number of types if there is none
+        size_t last(const std::vector<const TypeColumns*>& columns) const {
+            size_t best            = ids.size();
+            uint64_t bestTimestamp = 0;
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (positions[i] > 0) {
+                    const uint64_t timestamp = columns[i]->timestamp(positions[i] - 1);
+                    if (best == ids.size() || timestamp > bestTimestamp
+                        || (timestamp == bestTimestamp && ids[i] > ids[best])) {
+                        best          = i;
+                        bestTimestamp = timestamp;
+                    }
+                }
+            }
+            return best;
+        }
+
+        /// Remember the item before the cursor, so it can find its place again if items are added
+        void remember(const std::vector<const TypeColumns*>& columns) {
+            const size_t best = last(columns);
+            hasBefore         = best != ids.size();
+            if (hasBefore) {
+                beforeType = ids[best];
+                beforeItem = columns[best]->item(positions[best] - 1);
+            }
+        }
+
+        /// Find the cursor's place again if items have been added to any of the types since it was last moved
+        void sync(const std::vector<const TypeColumns*>& columns) {
+            bool changed = false;
+            for (size_t i = 0; i < ids.size(); i++) {
+                changed = changed || columns[i]->size() != sizes[i];
+            }
+            if (!changed) {
+                return;
+            }
+
+            for (size_t i = 0; i < ids.size(); i++) {
+                sizes[i] = columns[i]->size();
+                if (!hasBefore) {
+                    positions[i] = 0;
+                    continue;
+                }
+
+                // Items at the same timestamp as the item before the cursor are ordered by type id. Its own position
+                // may have changed, so it is found among the items of its type at that timestamp by its packet.
+                const size_t lower = columns[i]->lowerBound(beforeItem.item.timestamp);
+                const size_t upper = columns[i]->upperBound(beforeItem.item.timestamp);
+                positions[i]       = ids[i] < beforeType ? upper : lower;
+                if (ids[i] == beforeType) {
+                    positions[i] = upper;
+                    for (size_t position = lower; position < upper; position++) {
+                        if (samePacket(columns[i]->item(position), beforeItem)) {
+                            positions[i] = position + 1;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_TIMELINE_HPP
@@ -0,0 +1,108 @@
+#ifndef NBS_TIMESTAMPMODEL_HPP
+#define NBS_TIMESTAMPMODEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "SearchStats.hpp"
+
+namespace nbs {
+
+    /**
+     * A linear model of the position of each timestamp in a sorted column, for types whose timestamps are spaced
+     * almost uniformly such as periodic sensors.
+     *
+     * The model is the line from the first timestamp to the last. When it is fitted, the furthest any timestamp is from
+     * its predicted position is measured, so a search only needs to binary search the few positions within that
+     * distance of the prediction. Columns with large gaps or bursts have a large error, and aren't modelled.
+     */
+    class TimestampModel {
+    public:
+        /// Columns with fewer timestamps than this are quick enough to binary search
+        static constexpr size_t MIN_SIZE = 1024;
+
+        /// Columns whose timestamps are further than this from their predicted positions aren't modelled
+        static constexpr size_t MAX_ERROR = 64;
+
+        /**
+         * Fit the model to the given timestamps
+         *
+         * @param timestamps the timestamps, sorted in ascending order
+         * @param count      the number of timestamps
+         * @return           true if the timestamps are uniform enough to be searched using the model
+         */
+        bool fit(const uint64_t* timestamps, const size_t& count) {
+            valid = false;
+
+            if (count < MIN_SIZE || timestamps[count - 1] == timestamps[0]) {
+                return false;
+            }
+
+            first = timestamps[0];
+            slope = double(count - 1) / double(timestamps[count - 1] - timestamps[0]);
+
+            double maxError = 0;
+            for (size_t i = 0; i < count; i++) {
+                maxError = std::max(maxError, std::abs(predict(timestamps[i]) - double(i)));
+                if (maxError > double(MAX_ERROR)) {
+                    return false;
+                }
+            }
+
+            // Widen the bound by one position to cover rounding in the predictions
+            error = size_t(std::ceil(maxError)) + 1;
+            valid = true;
+            return true;
+        }
+
+        /// Check if the model was fitted successfully
+        bool empty() const {
+            return !valid;
+        }
+
+        /**
+         * Get the position of the first timestamp greater than the given timestamp
+         *
+         * @param timestamps the timestamps the model was fitted to
+         * @param count      the number of timestamps
+         * @param timestamp  the timestamp to search for
+         * @param probes     incremented for each timestamp probed
+         * @return           the position of the first greater timestamp, or `count` if there is none
+         */
+        size_t upperBound(const uint64_t* timestamps,
+                          const size_t& count,
+                          const uint64_t& timestamp,
+                          size_t& probes) const {
+            // Every timestamp is within `error` positions of its prediction, so the first timestamp greater than this
+            // one is within `error` positions of this one's prediction (plus one for where it falls between them)
+            const double predicted = timestamp < first ? 0.0 : std::min(predict(timestamp), double(count));
+            const size_t position  = size_t(predicted);
+
+            const size_t begin = position > error ? position - error : 0;
+            const size_t end   = std::min(count, position + error + 1);
+
+            return probedUpperBound(timestamps + begin, timestamps + end, timestamp, probes) - timestamps;
+        }
+
+    private:
+        bool valid = false;
+
+        /// The first timestamp in the column
+        uint64_t first = 0;
+
+        /// Positions per nanosecond
+        double slope = 0;
+
+        /// The furthest any timestamp is from its predicted position
+        size_t error = 0;
+
+        double predict(const uint64_t& timestamp) const {
+            return double(timestamp - first) * slope;
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_TIMESTAMPMODEL_HPP
@@ -0,0 +1,347 @@
+#ifndef NBS_TYPECOLUMNS_HPP
+#define NBS_TYPECOLUMNS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "Column.hpp"
+#include "CompactColumns.hpp"
+#include "IndexItem.hpp"
+#include "SearchStats.hpp"
+#include "SearchTree.hpp"
+#include "TimestampModel.hpp"
+#include "TypeSubtype.hpp"
+
+namespace nbs {
+
+    /**
+     * The index items of a single type and subtype, sorted by timestamp and stored as parallel columns.
+     *
+     * Keeping the timestamps in their own contiguous column means searching by timestamp only pulls timestamps into
+     * the cache, rather than whole index items.
+     *
+     * The columns can also be packed into CompactColumns, which releases the plain columns. The accessors below work
+     * either way, so only code that needs the plain columns (such as writing them to a cache) has to check.
+     */
+    struct TypeColumns {
+        /// The type and subtype of all the items
+        TypeSubtype type{};
+
+        /// The timestamp of each item
+        Column<uint64_t> timestamps;
+
+        /// The offset of each item's packet from the start of its nbs file
+        Column<uint64_t> offsets;
+
+        /// The length of each item's packet in bytes (including the header)
+        Column<uint32_t> lengths;
+
+        /// The index of the nbs file each item's packet is in
+        Column<uint32_t> filenos;
+
+        /// A model of the timestamps, only fitted for types with many uniformly spaced items
+        TimestampModel model;
+
+        /// A search tree over the timestamps, only built for types with many items that can't be modelled
+        SearchTree search;
+
+        /// The items encoded into blocks, when the columns are packed
+        CompactColumns compact;
+
+        /// Whether the items are in `compact` rather than the plain columns
+        bool packed = false;
+
+        /// Counts the searches of the timestamps
+        mutable SearchStats stats;
+
+        /// Get the number of items
+        size_t size() const {
+            return packed ? compact.size() : timestamps.size();
+        }
+
+        /// Encode the items into CompactColumns and release the plain columns
+        void pack() {
+            if (packed) {
+                return;
+            }
+
+            compact    = CompactColumns(timestamps.data(), offsets.data(), lengths.data(), filenos.data(), size());
+            packed     = true;
+            timestamps = Column<uint64_t>();
+            offsets    = Column<uint64_t>();
+            lengths    = Column<uint32_t>();
+            filenos    = Column<uint32_t>();
+            model      = TimestampModel();
+            search     = SearchTree();
+        }
+
+        /// Decode the items back into plain columns
+        void unpack() {
+            if (!packed) {
+                return;
+            }
+
+            std::vector<uint64_t> unpackedTimestamps;
+            std::vector<uint64_t> unpackedOffsets;
+            std::vector<uint32_t> unpackedLengths;
+            std::vector<uint32_t> unpackedFilenos;
+            unpackedTimestamps.reserve(size());
+            unpackedOffsets.reserve(size());
+            unpackedLengths.reserve(size());
+            unpackedFilenos.reserve(size());
+
+            compact.forEach(0, size(), [&](const CompactColumns::Entry& entry) {
+                unpackedTimestamps.push_back(entry.timestamp);
+                unpackedOffsets.push_back(entry.offset);
+                unpackedLengths.push_back(entry.length);
+                unpackedFilenos.push_back(entry.fileno);
+            });
+
+            timestamps = Column<uint64_t>(std::move(unpackedTimestamps));
+            offsets    = Column<uint64_t>(std::move(unpackedOffsets));
+            lengths    = Column<uint32_t>(std::move(unpackedLengths));
+            filenos    = Column<uint32_t>(std::move(unpackedFilenos));
+            compact    = CompactColumns();
+            packed     = false;
+        }
+
+        /// Get the number of bytes used by the items. Plain columns are counted in full even if they view a memory
+        /// mapped cache.
+        size_t memory() const {
+            return packed ? compact.memory() : size() * (sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2);
+        }
+
+        /**
+         * Add index items of this type to the columns, such as ones for packets appended to a file after it was
+         * indexed. Items that come after all the existing items are appended, otherwise the columns are merged.
+         *
+         * @param items the items to add, sorted by timestamp
+         */
+        void insert(const std::vector<IndexItemFile>& items) {
+            if (items.empty()) {
+                return;
+            }
+
+            if (packed && (size() == 0 || items.front().item.timestamp >= lastTimestamp())) {
+                std::vector<uint64_t> newTimestamps;
+                std::vector<uint64_t> newOffsets;
+                std::vector<uint32_t> newLengths;
+                std::vector<uint32_t> newFilenos;
+                for (auto& itemFile : items) {
+                    newTimestamps.push_back(itemFile.item.timestamp);
+                    newOffsets.push_back(itemFile.item.offset);
+                    newLengths.push_back(itemFile.item.length);
+                    newFilenos.push_back(uint32_t(itemFile.fileno));
+                }
+
+                compact.append(newTimestamps.data(),
+                               newOffsets.data(),
+                               newLengths.data(),
+                               newFilenos.data(),
+                               newTimestamps.size());
+                return;
+            }
+
+            // Merging needs the plain columns
+            const bool repack = packed;
+            unpack();
+
+            if (timestamps.empty() || items.front().item.timestamp >= timestamps.back()) {
+                std::vector<uint64_t> newTimestamps;
+                std::vector<uint64_t> newOffsets;
+                std::vector<uint32_t> newLengths;
+                std::vector<uint32_t> newFilenos;
+                for (auto& itemFile : items) {
+                    newTimestamps.push_back(itemFile.item.timestamp);
+                    newOffsets.push_back(itemFile.item.offset);
+                    newLengths.push_back(itemFile.item.length);
+                    newFilenos.push_back(uint32_t(itemFile.fileno));
+                }
+
+                timestamps.append(newTimestamps.data(), newTimestamps.size());
+                offsets.append(newOffsets.data(), newOffsets.size());
+                lengths.append(newLengths.data(), newLengths.size());
+                filenos.append(newFilenos.data(), newFilenos.size());
+            }
+            else {
+                // Merge the new items in after any existing items with the same timestamp
+                const size_t count = size() + items.size();
+                std::vector<uint64_t> mergedTimestamps;
+                std::vector<uint64_t> mergedOffsets;
+                std::vector<uint32_t> mergedLengths;
+                std::vector<uint32_t> mergedFilenos;
+                mergedTimestamps.reserve(count);
+                mergedOffsets.reserve(count);
+                mergedLengths.reserve(count);
+                mergedFilenos.reserve(count);
+
+                size_t existing = 0;
+                for (auto& itemFile : items) {
+                    for (; existing < size() && timestamps[existing] <= itemFile.item.timestamp; existing++) {
+                        mergedTimestamps.push_back(timestamps[existing]);
+                        mergedOffsets.push_back(offsets[existing]);
+                        mergedLengths.push_back(lengths[existing]);
+                        mergedFilenos.push_back(filenos[existing]);
+                    }
+                    mergedTimestamps.push_back(itemFile.item.timestamp);
+                    mergedOffsets.push_back(itemFile.item.offset);
+                    mergedLengths.push_back(itemFile.item.length);
+                    mergedFilenos.push_back(uint32_t(itemFile.fileno));
+                }
+                for (; existing < size(); existing++) {
+                    mergedTimestamps.push_back(timestamps[existing]);
+                    mergedOffsets.push_back(offsets[existing]);
+                    mergedLengths.push_back(lengths[existing]);
+                    mergedFilenos.push_back(filenos[existing]);
+                }
+
+                timestamps = Column<uint64_t>(std::move(mergedTimestamps));
+                offsets    = Column<uint64_t>(std::move(mergedOffsets));
+                lengths    = Column<uint32_t>(std::move(mergedLengths));
+                filenos    = Column<uint32_t>(std::move(mergedFilenos));
+            }
+
+            // The model and search tree only know about the old timestamps
+            model  = TimestampModel();
+            search = SearchTree();
+
+            if (repack) {
+                pack();
+            }
+        }
+
+        /**
+         * Choose how upperBound will search the timestamps. A model is used if `interpolation` is set and the
+         * timestamps are uniform enough, otherwise a search tree is built if there are at least `treeThreshold`
+         * items, otherwise the whole column is binary searched.
+         */
+        void prepareSearch(const size_t& treeThreshold, const bool& interpolation) {
+            model  = TimestampModel();
+            search = SearchTree();
+
+            // Packed columns are always searched by their blocks
+            if (packed) {
+                return;
+            }
+
+            if (interpolation && model.fit(timestamps.data(), timestamps.size())) {
+                return;
+            }
+
+            if (size() >= treeThreshold) {
+                search = SearchTree(timestamps.data(), timestamps.size());
+            }
+        }
+
+        /// Get how upperBound searches the timestamps
+        SearchStrategy strategy() const {
+            return packed            ? SearchStrategy::COMPACT
+                   : !model.empty()  ? SearchStrategy::INTERPOLATION
+                   : !search.empty() ? SearchStrategy::TREE
+                                     : SearchStrategy::BINARY;
+        }
+
+        /// Get the position of the first item with a timestamp greater than the given timestamp
+        size_t upperBound(const uint64_t& timestamp) const {
+            size_t probes = 0;
+            size_t position;
+
+            if (packed) {
+                position = compact.upperBound(timestamp, probes);
+            }
+            else if (!model.empty()) {
+                position = model.upperBound(timestamps.data(), timestamps.size(), timestamp, probes);
+            }
+            else if (!search.empty()) {
+                position = search.upperBound(timestamps.data(), timestamps.size(), timestamp, probes);
+            }
+            else {
+                position = std::distance(timestamps.begin(),
+                                         probedUpperBound(timestamps.begin(), timestamps.end(), timestamp, probes));
+            }
+
+            stats.record(probes);
+            return position;
+        }
+
+        /// Get the position of the first item with a timestamp at or after the given timestamp
+        size_t lowerBound(const uint64_t& timestamp) const {
+            return timestamp == 0 ? 0 : upperBound(timestamp - 1);
+        }
+
+        /// Get the timestamp of the item at the given position
+        uint64_t timestamp(const size_t& position) const {
+            return packed ? compact.get(position).timestamp : timestamps[position];
+        }
+
+        /// Get the timestamp of the first item, which must exist
+        uint64_t firstTimestamp() const {
+            return timestamp(0);
+        }
+
+        /// Get the timestamp of the last item, which must exist
+        uint64_t lastTimestamp() const {
+            return timestamp(size() - 1);
+        }
+
+        /// Get the full index item at the given position
+        IndexItemFile item(const size_t& position) const {
+            if (packed) {
+                return item(compact.get(position));
+            }
+
+            IndexItemFile itemFile{};
+            itemFile.item.type      = type.type;
+            itemFile.item.subtype   = type.subtype;
+            itemFile.item.timestamp = timestamps[position];
+            itemFile.item.offset    = offsets[position];
+            itemFile.item.length    = lengths[position];
+            itemFile.fileno         = int(filenos[position]);
+            return itemFile;
+        }
+
+        /// Call `fn` with each full index item in [begin, end), in order. This is much faster than calling item()
+        /// for each position when the columns are packed.
+        template <typename F>
+        void forEach(const size_t& begin, const size_t& end, F&& fn) const {
+            if (packed) {
+                compact.forEach(begin, end, [&](const CompactColumns::Entry& entry) { fn(item(entry)); });
+            }
+            else {
+                for (size_t position = begin; position < end; position++) {
+                    fn(item(position));
+                }
+            }
+        }
+
+        /// Copy the timestamps of the items in [begin, end) into `out`, which must have room for them. Plain columns
+        /// are copied in one go, without building an index item for each.
+        void copyTimestamps(const size_t& begin, const size_t& end, uint64_t* out) const {
+            if (packed) {
+                compact.forEach(begin, end, [&](const CompactColumns::Entry& entry) { *out++ = entry.timestamp; });
+            }
+            else if (end > begin) {
+                std::memcpy(out, timestamps.data() + begin, (end - begin) * sizeof(uint64_t));
+            }
+        }
+
+    private:
+        /// Get the full index item for an item decoded from the packed columns
+        IndexItemFile item(const CompactColumns::Entry& entry) const {
+            IndexItemFile itemFile{};
+            itemFile.item.type      = type.type;
+            itemFile.item.subtype   = type.subtype;
+            itemFile.item.timestamp = entry.timestamp;
+            itemFile.item.offset    = entry.offset;
+            itemFile.item.length    = entry.length;
+            itemFile.fileno         = int(entry.fileno);
+            return itemFile;
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_TYPECOLUMNS_HPP
@@ -0,0 +1,157 @@
+#ifndef NBS_TYPECURSOR_HPP
+#define NBS_TYPECURSOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Index.hpp"
+#include "IndexItem.hpp"
+#include "SearchStats.hpp"
+#include "TypeColumns.hpp"
+#include "TypeIdMap.hpp"
+#include "TypeSubtype.hpp"
+
+namespace nbs {
+
+    /**
+     * Finds the items of a fixed list of types at a timestamp, the same items getPackets() finds, for a timestamp that
+     * only moves a little between calls such as during playback.
+     *
+     * The cursor keeps its position in each type and gallops from there to the new timestamp: it probes 1, 2, 4, ...
+     * items away until it passes the timestamp, then binary searches the last step. Moving k items costs O(log k)
+     * probes, so small steps cost O(1) per type, and a jump costs about the same as searching the whole type.
+     */
+    class TypeCursor {
+    public:
+        /**
+         * Create a cursor at the start of each type
+         *
+         * @param types the types to find items of. Types that aren't in the index are skipped.
+         */
+        explicit TypeCursor(std::vector<TypeSubtype> types = {}) : types(std::move(types)) {}
+
+        /**
+         * Get the last item at or before the given timestamp of each of the cursor's types, and move the cursor there.
+         * Types with no item at or before the timestamp get an item with a length of 0 and the given timestamp.
+         */
+        std::vector<IndexItemFile> seek(const Index& index, const uint64_t& timestamp) {
+            // Types added to the index since the cursor last looked may be some of its types
+            if (index.getTypeCount() != this->typeCount) {
+                this->resolve(index);
+            }
+
+            auto columns = index.getColumnsForIds(this->ids);
+
+            std::vector<IndexItemFile> items;
+            items.reserve(columns.size());
+            for (size_t i = 0; i < columns.size(); i++) {
+                auto& type         = *columns[i];
+                this->positions[i] = gallop(type, this->positions[i], timestamp);
+
+                if (this->positions[i] == 0) {
+                    IndexItemFile empty{};
+                    empty.item.timestamp = timestamp;
+                    empty.item.type      = type.type.type;
+                    empty.item.subtype   = type.type.subtype;
+                    items.push_back(empty);
+                }
+                else {
+                    items.push_back(type.item(this->positions[i] - 1));
+                }
+            }
+
+            return items;
+        }
+
+        /**
+         * Get the position of the first item with a timestamp greater than the given timestamp, searching outwards
+         * from `hint`. This gives the same position as `columns.upperBound()` for any hint.
+         */
+        static size_t gallop(const TypeColumns& columns, size_t hint, const uint64_t& timestamp) {
+            // Reading a packed timestamp decodes part of a block, so those are searched by their blocks instead
+            if (columns.packed) {
+                return columns.upperBound(timestamp);
+            }
+
+            const uint64_t* timestamps = columns.timestamps.data();
+            const size_t size          = columns.size();
+            hint                       = std::min(hint, size);
+
+            size_t probes   = 0;
+            size_t position = 0;
+            size_t step     = 1;
+
+            if (hint < size && timestamps[hint] <= timestamp) {
+                // Forwards: every item up to the hint is at or before the timestamp
+                size_t low = hint + 1;
+                position   = size;
+                while (low < size) {
+                    const size_t probe = std::min(low + step - 1, size - 1);
+                    probes++;
+                    if (timestamps[probe] > timestamp) {
+                        position =
+                            probedUpperBound(timestamps + low, timestamps + probe, timestamp, probes) - timestamps;
+                        break;
+                    }
+                    low = probe + 1;
+                    step *= 2;
+                }
+            }
+            else {
+                // Backwards: every item from the hint on is after the timestamp
+                size_t high = hint;
+                while (high > 0) {
+                    const size_t probe = high > step ? high - step : 0;
+                    probes++;
+                    if (timestamps[probe] <= timestamp) {
+                        position =
+                            probedUpperBound(timestamps + probe + 1, timestamps + high, timestamp, probes) - timestamps;
+                        break;
+                    }
+                    high = probe;
+                    step *= 2;
+                }
+            }
+
+            columns.stats.record(probes);
+            return position;
+        }
+
+    private:
+        /// The types to find items of
+        std::vector<TypeSubtype> types;
+
+        /// The ids of the types that are in the index
+        std::vector<TypeId> ids;
+
+        /// The position of the first item after the cursor in each of the types in `ids`
+        std::vector<size_t> positions;
+
+        /// The number of types in the index when the ids were found
+        size_t typeCount = 0;
+
+        /// Find the ids of the cursor's types in the index, keeping the position of any types it already had
+        void resolve(const Index& index) {
+            std::vector<TypeId> newIds;
+            std::vector<size_t> newPositions;
+            for (auto& type : this->types) {
+                TypeId id = index.getTypeId(type);
+                if (id == NO_TYPE_ID) {
+                    continue;
+                }
+
+                auto found = std::find(this->ids.begin(), this->ids.end(), id);
+                newIds.push_back(id);
+                newPositions.push_back(found != this->ids.end() ? this->positions[found - this->ids.begin()] : 0);
+            }
+
+            this->ids       = std::move(newIds);
+            this->positions = std::move(newPositions);
+            this->typeCount = index.getTypeCount();
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_TYPECURSOR_HPP
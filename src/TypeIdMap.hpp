@@ -0,0 +1,101 @@
+#ifndef NBS_TYPEIDMAP_HPP
+#define NBS_TYPEIDMAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "TypeSubtype.hpp"
+
+namespace nbs {
+
+    /// A dense integer id for a (type, subtype) in an index, usable as a position in a vector
+    using TypeId = uint32_t;
+
+    /// The id returned for a (type, subtype) that isn't in an index
+    constexpr TypeId NO_TYPE_ID = 0xFFFFFFFF;
+
+    /**
+     * A flat, open addressing hash map from (type, subtype) to its dense TypeId.
+     *
+     * All the slots live in one vector and collisions are resolved by probing the following slots, so a lookup is
+     * normally a single hash and a single cache line, with no pointers to chase.
+     */
+    class TypeIdMap {
+    public:
+        /// Get the id of the given type, or NO_TYPE_ID if it isn't in the map
+        TypeId find(const TypeSubtype& type) const {
+            if (slots.empty()) {
+                return NO_TYPE_ID;
+            }
+
+            const size_t mask = slots.size() - 1;
+            for (size_t i = hash(type) & mask;; i = (i + 1) & mask) {
+                const Slot& slot = slots[i];
+                if (slot.id == NO_TYPE_ID || slot.type == type) {
+                    return slot.id;
+                }
+            }
+        }
+
+        /// Set the id of the given type, replacing its id if it is already in the map
+        void insert(const TypeSubtype& type, const TypeId& id) {
+            // Keep the map at most half full so probe sequences stay short
+            if ((count + 1) * 2 > slots.size()) {
+                grow();
+            }
+
+            const size_t mask = slots.size() - 1;
+            for (size_t i = hash(type) & mask;; i = (i + 1) & mask) {
+                Slot& slot = slots[i];
+                if (slot.id == NO_TYPE_ID) {
+                    slot.type = type;
+                    slot.id   = id;
+                    count++;
+                    return;
+                }
+                if (slot.type == type) {
+                    slot.id = id;
+                    return;
+                }
+            }
+        }
+
+        /// Get the number of types in the map
+        size_t size() const {
+            return count;
+        }
+
+    private:
+        struct Slot {
+            TypeSubtype type{};
+            TypeId id = NO_TYPE_ID;
+        };
+
+        /// The slots of the map, always a power of two in size
+        std::vector<Slot> slots;
+
+        /// The number of types in the map
+        size_t count = 0;
+
+        /// The type is already an XX64 hash, so mixing in the subtype is all that's needed
+        static size_t hash(const TypeSubtype& type) {
+            return size_t(type.type ^ (uint64_t(type.subtype) * 0x9E3779B97F4A7C15ULL));
+        }
+
+        /// Double the number of slots and reinsert everything
+        void grow() {
+            std::vector<Slot> old(slots.empty() ? 16 : slots.size() * 2);
+            std::swap(old, slots);
+            count = 0;
+
+            for (auto& slot : old) {
+                if (slot.id != NO_TYPE_ID) {
+                    insert(slot.type, slot.id);
+                }
+            }
+        }
+    };
+
+}  // namespace nbs
+
+#endif  // NBS_TYPEIDMAP_HPP
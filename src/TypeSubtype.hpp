@@ -16,6 +16,15 @@ namespace nbs {
     inline bool operator<(const TypeSubtype& lhs, const TypeSubtype& rhs) {
         return (lhs.type < rhs.type) || ((lhs.type == rhs.type) && (lhs.subtype < rhs.subtype));
     }
+
+    // Compares two TypeSubtype objects for equality
+    inline bool operator==(const TypeSubtype& lhs, const TypeSubtype& rhs) {
+        return lhs.type == rhs.type && lhs.subtype == rhs.subtype;
+    }
+
+    inline bool operator!=(const TypeSubtype& lhs, const TypeSubtype& rhs) {
+        return !(lhs == rhs);
+    }
 }  // namespace nbs
 
 #endif  // NBS_TYPESUBTYPE_HPP
@@ -1,9 +1,11 @@
 const fs = require('fs');
+const os = require('os');
 const path = require('path');
+const zlib = require('zlib');
 const { test } = require('uvu');
 const assert = require('uvu/assert');
 
-const { NbsDecoder } = require('..');
+const { NbsDecoder, NbsEncoder } = require('..');
 
 /** Convert the given timestamp object to a BigInt of nanoseconds */
 function tsToBigInt(ts) {
@@ -24,7 +26,32 @@ function assertSnapshot(value, fileName, message) {
   }
 }
 
+function usingTempDir(callback) {
+  const tempDir = fs.mkdtempSync(`${os.tmpdir()}${path.sep}`);
+  const remove = () => fs.rmSync(tempDir, { recursive: true });
+
+  let result;
+  try {
+    result = callback(tempDir);
+  } catch (error) {
+    remove();
+    throw error;
+  }
+
+  // Async callbacks keep the directory until they settle
+  if (result instanceof Promise) {
+    return result.finally(remove);
+  }
+  remove();
+  return result;
+}
+
 const samplesDir = path.join(__dirname, 'sample');
+const samplePaths = [
+  path.join(samplesDir, 'sample-000-300.nbs'),
+  path.join(samplesDir, 'sample-300-600.nbs'),
+  path.join(samplesDir, 'sample-600-900.nbs'),
+];
 
 // What's in the sample nbs files:
 // For each sample file:
@@ -35,11 +62,7 @@ const samplesDir = path.join(__dirname, 'sample');
 //     E.g. for the file "sample-001-300.nbs" $i goes from 1 to 100.
 //   - Pang messages also have a subtype: 100 or 200. 100 is used for even-indexed pang messages, 200 for odd-indexed.
 // The timestamps begin at 1000 seconds after epoch for the first message in the first file and increment by 1 second between messages.
-const decoder = new NbsDecoder([
-  path.join(samplesDir, 'sample-000-300.nbs'),
-  path.join(samplesDir, 'sample-300-600.nbs'),
-  path.join(samplesDir, 'sample-600-900.nbs'),
-]);
+const decoder = new NbsDecoder(samplePaths);
 
 const pingType = Buffer.from('8ce1582fa0eadc84', 'hex'); // nuclear hash of 'message.Ping'
 const pongType = Buffer.from('37c56336526573bb', 'hex'); // nuclear hash of 'message.Pong'
@@ -79,6 +102,315 @@ test('NbsDecoder constructor throws for invalid arguments', () => {
   );
 });
 
+test('NbsDecoder constructor throws for invalid options', () => {
+  const samplePath = path.join(samplesDir, 'sample-000-300.nbs');
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], false);
+    },
+    /invalid argument `options`: expected object/,
+    'NbsDecoder() constructor throws for non-object options'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { indexCache: 1 });
+    },
+    /invalid option `indexCache`: expected string or boolean/,
+    'NbsDecoder() constructor throws for invalid `indexCache` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { searchTreeThreshold: -1 });
+    },
+    /invalid option `searchTreeThreshold`: expected non-negative number/,
+    'NbsDecoder() constructor throws for invalid `searchTreeThreshold` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { lazy: 'yes' });
+    },
+    /invalid option `lazy`: expected boolean/,
+    'NbsDecoder() constructor throws for invalid `lazy` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { zeroCopy: 1 });
+    },
+    /invalid option `zeroCopy`: expected boolean/,
+    'NbsDecoder() constructor throws for invalid `zeroCopy` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { packetCache: -1 });
+    },
+    /invalid option `packetCache`: expected non-negative number/,
+    'NbsDecoder() constructor throws for invalid `packetCache` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { accessPattern: 'backwards' });
+    },
+    /invalid option `accessPattern`: expected 'normal', 'sequential', or 'random'/,
+    'NbsDecoder() constructor throws for invalid `accessPattern` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { populate: -1 });
+    },
+    /invalid option `populate`: expected non-negative number/,
+    'NbsDecoder() constructor throws for invalid `populate` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { hugePages: 'yes' });
+    },
+    /invalid option `hugePages`: expected boolean/,
+    'NbsDecoder() constructor throws for invalid `hugePages` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { compactIndex: 'yes' });
+    },
+    /invalid option `compactIndex`: expected boolean/,
+    'NbsDecoder() constructor throws for invalid `compactIndex` option'
+  );
+
+  assert.throws(
+    () => {
+      new NbsDecoder([samplePath], { interpolationSearch: 1 });
+    },
+    /invalid option `interpolationSearch`: expected boolean/,
+    'NbsDecoder() constructor throws for invalid `interpolationSearch` option'
+  );
+});
+
+test('NbsDecoder with `indexCache` creates, reuses, and rebuilds the index cache', () => {
+  usingTempDir((dir) => {
+    const files = ['sample-000-300.nbs', 'sample-300-600.nbs'].map((file) => {
+      fs.copyFileSync(path.join(samplesDir, file), path.join(dir, file));
+      fs.copyFileSync(path.join(samplesDir, file + '.idx'), path.join(dir, file + '.idx'));
+      return path.join(dir, file);
+    });
+    const cachePath = path.join(dir, 'index.cache');
+
+    const uncached = new NbsDecoder(files);
+    const expected = uncached.getTypeIndex({ type: pingType, subtype: 0 });
+    uncached.close();
+
+    // The first open builds the cache, the second loads it
+    for (let i = 0; i < 2; i++) {
+      const cached = new NbsDecoder(files, { indexCache: cachePath });
+      assert.ok(fs.existsSync(cachePath), 'the index cache file is created');
+      assert.equal(cached.getTypeIndex({ type: pingType, subtype: 0 }), expected);
+      assert.equal(
+        cached.getPacketByIndex(1, { type: pingType, subtype: 0 }).payload.toString(),
+        'ping.1'
+      );
+      cached.close();
+    }
+
+    // A cache with items outside of the nbs files is rebuilt rather than read from
+    const cache = fs.readFileSync(cachePath);
+    const fileCount = cache.readUInt32LE(12);
+    const typeCount = Number(cache.readBigUInt64LE(16));
+    const itemCount = Number(cache.readBigUInt64LE(24));
+    const offsets = 32 + fileCount * 40 + typeCount * 32 + itemCount * 8;
+    const corrupt = [
+      (bytes) => bytes.writeUInt32LE(fileCount, bytes.length - 4),
+      (bytes) => bytes.writeBigUInt64LE(2n ** 40n, offsets),
+    ];
+    for (const change of corrupt) {
+      const bytes = Buffer.from(cache);
+      change(bytes);
+      fs.writeFileSync(cachePath, bytes);
+
+      const corrupted = new NbsDecoder(files, { indexCache: cachePath });
+      assert.equal(corrupted.getTypeIndex({ type: pingType, subtype: 0 }), expected);
+      assert.equal(corrupted.getPacketsInRange(...corrupted.getTimestampRange()).length, 600);
+      corrupted.close();
+    }
+
+    // Replacing one of the files makes the cache stale, so it is rebuilt from the new file
+    fs.copyFileSync(path.join(samplesDir, 'sample-600-900.nbs'), files[1]);
+    fs.copyFileSync(path.join(samplesDir, 'sample-600-900.nbs.idx'), files[1] + '.idx');
+
+    const rebuilt = new NbsDecoder(files, { indexCache: cachePath });
+    const [, end] = rebuilt.getTimestampRange({ type: pingType, subtype: 0 });
+    assert.equal(end, { seconds: 1897, nanos: 0 }, 'the rebuilt index includes the replaced file');
+    rebuilt.close();
+  });
+});
+
+test('NbsDecoder builds the index by scanning nbs files without an index file', () => {
+  usingTempDir((dir) => {
+    const file = path.join(dir, 'sample-000-300.nbs');
+    fs.copyFileSync(path.join(samplesDir, 'sample-000-300.nbs'), file);
+
+    // Truncate the last packet, like a recording that lost power while writing
+    const size = fs.statSync(file).size;
+    fs.truncateSync(file, size - 3);
+
+    const scanned = new NbsDecoder([file]);
+
+    // Subtypes aren't stored in the nbs file, so all the scanned packets have a subtype of 0
+    assert.equal(scanned.getTypeIndex({ type: pingType, subtype: 0 }).length, 100);
+    assert.equal(scanned.getTypeIndex({ type: pongType, subtype: 0 }).length, 100);
+    assert.equal(
+      scanned.getTypeIndex({ type: pangType, subtype: 0 }).length,
+      99,
+      'the truncated packet is skipped'
+    );
+
+    assert.equal(scanned.getPacketByIndex(1, { type: pingType, subtype: 0 }), {
+      timestamp: { seconds: 1003, nanos: 0 },
+      type: pingType,
+      subtype: 0,
+      payload: Buffer.from('ping.1', 'utf8'),
+    });
+    scanned.close();
+
+    assert.not.ok(fs.existsSync(file + '.idx'), 'the index file is not written by default');
+
+    const written = new NbsDecoder([file], { writeScannedIndex: true });
+    written.close();
+    assert.ok(fs.existsSync(file + '.idx'), 'the index file is written with `writeScannedIndex`');
+
+    const reopened = new NbsDecoder([file]);
+    assert.equal(reopened.getTypeIndex({ type: pangType, subtype: 0 }).length, 99);
+    reopened.close();
+  });
+});
+
+test('NbsDecoder with `lazy` gives the same results as loading the whole index', () => {
+  const lazyDecoder = new NbsDecoder(samplePaths, { lazy: true });
+
+  // The types and timestamp ranges are known without loading anything
+  assert.equal(lazyDecoder.getAvailableTypes(), decoder.getAvailableTypes());
+  assert.equal(lazyDecoder.getTimestampRange(), decoder.getTimestampRange());
+  assert.equal(
+    lazyDecoder.getTimestampRange({ type: pangType, subtype: 200 }),
+    decoder.getTimestampRange({ type: pangType, subtype: 200 })
+  );
+
+  const timestamp = { seconds: 1450, nanos: 0 };
+  assert.equal(lazyDecoder.getPackets(timestamp, [{ type: pingType, subtype: 0 }]), [
+    decoder.getPackets(timestamp, [{ type: pingType, subtype: 0 }])[0],
+  ]);
+  assert.equal(lazyDecoder.getPackets(timestamp), decoder.getPackets(timestamp));
+
+  // Evicted types are loaded again when they are next used
+  lazyDecoder.evict([{ type: pingType, subtype: 0 }]);
+  assert.equal(
+    lazyDecoder.getTypeIndex({ type: pingType, subtype: 0 }),
+    decoder.getTypeIndex({ type: pingType, subtype: 0 })
+  );
+
+  lazyDecoder.evict();
+  assert.equal(
+    lazyDecoder.nextTimestamp(timestamp, { type: pangType, subtype: 100 }, 2),
+    decoder.nextTimestamp(timestamp, { type: pangType, subtype: 100 }, 2)
+  );
+
+  lazyDecoder.close();
+});
+
+test('NbsDecoder.follow() reads the packets appended to nbs files without an index file', async () => {
+  await usingTempDir(async (dir) => {
+    const file = path.join(dir, 'sample-000-300.nbs');
+    fs.copyFileSync(path.join(samplesDir, 'sample-000-300.nbs'), file);
+
+    // Write the packet to append with an encoder, to get its bytes
+    const appendFile = path.join(dir, 'append.nbs');
+    const encoder = new NbsEncoder(appendFile);
+    encoder.write({
+      timestamp: { seconds: 2000, nanos: 0 },
+      type: pingType,
+      payload: Buffer.from('ping.new', 'utf8'),
+    });
+    encoder.close();
+
+    const following = new NbsDecoder([file]);
+    const event = await new Promise((resolve) => {
+      following.follow(resolve, { interval: 10 });
+      fs.appendFileSync(file, fs.readFileSync(appendFile));
+    });
+    following.unfollow();
+
+    assert.equal(event, {
+      packets: 1,
+      start: { seconds: 2000, nanos: 0 },
+      end: { seconds: 2000, nanos: 0 },
+    });
+    assert.equal(following.getTypeIndex({ type: pingType, subtype: 0 }).length, 101);
+    const packets = following.getPackets({ seconds: 2000, nanos: 0 }, [
+      { type: pingType, subtype: 0 },
+    ]);
+    assert.equal(packets[0].payload, Buffer.from('ping.new', 'utf8'));
+
+    following.close();
+  });
+});
+
+test('NbsDecoder.follow() reads the entries appended to the index files', async () => {
+  await usingTempDir(async (dir) => {
+    const file = path.join(dir, 'sample-000-300.nbs');
+    fs.copyFileSync(path.join(samplesDir, 'sample-000-300.nbs'), file);
+    fs.copyFileSync(path.join(samplesDir, 'sample-000-300.nbs.idx'), file + '.idx');
+
+    // Write the packet to append with an encoder, to get its bytes and index entry. The nbs file only has the
+    // timestamp in microseconds, while the index entry has it in full.
+    const appendFile = path.join(dir, 'append.nbs');
+    const encoder = new NbsEncoder(appendFile);
+    encoder.write({
+      timestamp: { seconds: 2000, nanos: 123456789 },
+      type: pangType,
+      subtype: 200,
+      payload: Buffer.from('pang.new', 'utf8'),
+    });
+    encoder.close();
+
+    // Move the entry to where the packet will be in the followed file, and append it as another gzip member
+    const entry = zlib.gunzipSync(fs.readFileSync(appendFile + '.idx'));
+    entry.writeBigUInt64LE(BigInt(fs.statSync(file).size), 20);
+
+    const type = { type: pangType, subtype: 200 };
+    const following = new NbsDecoder([file]);
+    const count = following.getTypeIndex(type).length;
+    const event = await new Promise((resolve) => {
+      following.follow(resolve, { interval: 10 });
+
+      // The entry is held back until its packet has been written
+      fs.appendFileSync(file + '.idx', zlib.gzipSync(entry));
+      setTimeout(() => fs.appendFileSync(file, fs.readFileSync(appendFile)), 50);
+    });
+    following.unfollow();
+
+    assert.equal(event, {
+      packets: 1,
+      start: { seconds: 2000, nanos: 123456789 },
+      end: { seconds: 2000, nanos: 123456789 },
+    });
+    assert.is(following.getTypeIndex(type).length, count + 1);
+    assert.is(following.getTypeIndex({ type: pangType, subtype: 0 }).length, 0);
+
+    const packets = following.getPackets({ seconds: 2001, nanos: 0 }, [type]);
+    assert.equal(packets[0].subtype, 200);
+    assert.equal(packets[0].payload, Buffer.from('pang.new', 'utf8'));
+
+    following.close();
+  });
+});
+
 test('NbsDecoder.getTypeIndex() returns the correct index for the given type subtype', () => {
   const pingIndices = decoder.getTypeIndex({ type: pingType, subtype: 0 });
   assert.equal(pingIndices.length, 300);
@@ -108,6 +440,36 @@ test('NbsDecoder.getTypeIndex() returns the correct index with the correct packe
   assert.equal(pingIndices[lastIndex], { seconds: 1897, nanos: 0 });
 });
 
+test('NbsDecoder.getTypeIndex() returns typed arrays of timestamps with the `format` option', () => {
+  const type = { type: pingType, subtype: 0 };
+  const expected = decoder.getTypeIndex(type);
+
+  const compact = new NbsDecoder(samplePaths, { compactIndex: true });
+
+  for (const source of [decoder, compact]) {
+    const nanos = source.getTypeIndex(type, { format: 'bigint' });
+    assert.instance(nanos, BigUint64Array);
+    assert.equal(Array.from(nanos), expected.map(tsToBigInt));
+
+    const millis = source.getTypeIndex(type, { format: 'milliseconds' });
+    assert.instance(millis, Float64Array);
+    assert.equal(Array.from(millis), expected.map((ts) => ts.seconds * 1e3 + ts.nanos / 1e6));
+
+    assert.equal(source.getTypeIndex(type, { format: 'object' }), expected);
+  }
+
+  assert.is(
+    decoder.getTypeIndex({ type: 'fakeIndex', subtype: 0 }, { format: 'bigint' }).length,
+    0
+  );
+
+  assert.throws(
+    () => decoder.getTypeIndex(type, { format: 'nanos' }),
+    /invalid option `format`: expected 'object', 'bigint', or 'milliseconds'/,
+    'NbsDecoder.getTypeIndex() throws for invalid `format` option'
+  );
+});
+
 test('NbsDecoder.getAvailableTypes() returns a list of all the types available in the nbs files', () => {
   const types = decoder.getAvailableTypes();
 
@@ -120,6 +482,103 @@ test('NbsDecoder.getAvailableTypes() returns a list of all the types available i
   );
 });
 
+test('NbsDecoder.resolveTypes() returns type ids that can be passed in place of types', () => {
+  const types = [
+    { type: pingType, subtype: 0 },
+    { type: pangType, subtype: 200 },
+    { type: 'fakeIndex', subtype: 0 },
+  ];
+  const ids = decoder.resolveTypes(types);
+
+  assert.instance(ids, Uint32Array);
+  assert.is(ids.length, 3);
+  assert.is(ids[2], 0xffffffff, 'types not in the decoder have no id');
+
+  const timestamp = { seconds: 1450, nanos: 0 };
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+  assert.equal(decoder.getPackets(timestamp, ids), decoder.getPackets(timestamp, types));
+  assert.equal(
+    decoder.getPacketsInRange(start, end, ids),
+    decoder.getPacketsInRange(start, end, types)
+  );
+  assert.equal(
+    decoder.nextTimestamp(timestamp, ids, 3),
+    decoder.nextTimestamp(timestamp, types, 3)
+  );
+
+  const cursor = decoder.cursor({ types: ids });
+  assert.equal(
+    cursor.next(),
+    decoder.getPacketsInRange(decoder.getTimestampRange()[0], end, types)[0]
+  );
+
+  assert.throws(
+    () => decoder.getTypeIndex(ids[0]),
+    /invalid type for argument `typeSubtype`: expected object/,
+    'NbsDecoder.getTypeIndex() throws for a single type id'
+  );
+  assert.throws(
+    () => decoder.getPackets(timestamp, [ids[0]]),
+    /invalid item type in `types` array: expected object/,
+    'NbsDecoder.getPackets() throws for type ids in a plain array'
+  );
+  assert.throws(
+    () => decoder.resolveTypes({ type: pingType, subtype: 0 }),
+    /invalid type for argument `types`: expected array/,
+    'NbsDecoder.resolveTypes() throws for non-array argument'
+  );
+});
+
+test('NbsDecoder.getDensity() counts the packets of a type in power of two buckets', () => {
+  const type = { type: pangType, subtype: 100 };
+
+  for (const [start, end, buckets] of [
+    [1000e9, 1899e9, 10],
+    [1100e9, 1300e9, 64],
+    [1450e9, 1460e9, 1000],
+  ]) {
+    const density = decoder.getDensity(type, start, end, buckets);
+    const first = tsToBigInt(density.start);
+    const width = BigInt(density.width);
+
+    assert.ok(density.counts.length >= buckets && density.counts.length <= 2 * buckets + 2);
+    assert.ok(first <= BigInt(start));
+    assert.ok(first + width * BigInt(density.counts.length) > BigInt(end));
+
+    // Count the packets in each bucket by hand
+    const last = first + width * BigInt(density.counts.length) - 1n;
+    const counts = new Array(density.counts.length).fill(0);
+    const bytes = new Array(density.counts.length).fill(0);
+    const mins = new Array(density.counts.length).fill(0n);
+    const maxes = new Array(density.counts.length).fill(0n);
+    for (const packet of decoder.getPacketsInRange(first, last, [type])) {
+      const timestamp = tsToBigInt(packet.timestamp);
+      const bucket = Number((timestamp - first) / width);
+      if (counts[bucket]++ === 0) {
+        mins[bucket] = timestamp;
+      }
+      maxes[bucket] = timestamp;
+      bytes[bucket] += packet.payload.length + 23;
+    }
+
+    assert.equal(Array.from(density.counts), counts);
+    assert.equal(Array.from(density.bytes), bytes);
+    assert.equal(Array.from(density.min), mins);
+    assert.equal(Array.from(density.max), maxes);
+  }
+
+  const missing = decoder.getDensity({ type: 'fakeIndex', subtype: 0 }, 1000e9, 1899e9, 4);
+  assert.ok(missing.counts.every((count) => count === 0));
+  assert.is(decoder.getDensity(type, 1899e9, 1000e9, 4).counts.length, 0);
+
+  assert.throws(
+    () => decoder.getDensity(type, 1000e9, 1899e9, 0),
+    /invalid argument `buckets`: expected positive integer/,
+    'NbsDecoder.getDensity() throws for invalid `buckets` argument'
+  );
+});
+
 test('NbsDecoder.getTimestampRange() throws for invalid arguments', () => {
   assert.throws(
     () => {
@@ -467,6 +926,666 @@ test('NbsDecoder.getPackets() returns the last packet of each type when given a
   });
 });
 
+test('NbsDecoder.getPackets() and nextTimestamp() give the same results with and without search trees', () => {
+  const withTrees = new NbsDecoder(samplePaths, { searchTreeThreshold: 0 });
+  const withoutTrees = new NbsDecoder(samplePaths, { searchTreeThreshold: Infinity });
+
+  for (let seconds = 998; seconds <= 1902; seconds += 7) {
+    const timestamp = { seconds, nanos: 500 };
+    assert.equal(withTrees.getPackets(timestamp), withoutTrees.getPackets(timestamp));
+    assert.equal(
+      withTrees.nextTimestamp(timestamp, { type: pangType, subtype: 100 }, 3),
+      withoutTrees.nextTimestamp(timestamp, { type: pangType, subtype: 100 }, 3)
+    );
+  }
+
+  withTrees.close();
+  withoutTrees.close();
+});
+
+test('NbsDecoder.getPackets() and nextTimestamp() give the same results with and without interpolation search', () => {
+  usingTempDir((dir) => {
+    // Write a type sampled at a fixed rate with some jitter, which is uniform enough to interpolate
+    const file = path.join(dir, 'uniform.nbs');
+    const encoder = new NbsEncoder(file);
+    for (let i = 0; i < 4096; i++) {
+      encoder.write({
+        timestamp: {
+          seconds: 1000 + Math.floor(i / 100),
+          nanos: (i % 100) * 10000000 + ((i * 7919) % 1000) * 1000,
+        },
+        type: pingType,
+        payload: Buffer.from(`ping.${i}`, 'utf8'),
+      });
+    }
+    encoder.close();
+
+    const interpolated = new NbsDecoder([file], { searchStats: true });
+    const searched = new NbsDecoder([file], { interpolationSearch: false, searchStats: true });
+
+    for (let nanos = 0; nanos <= 41 * 1e9; nanos += 9876543) {
+      const timestamp = { seconds: 999 + Math.floor(nanos / 1e9), nanos: nanos % 1e9 };
+      assert.equal(interpolated.getPackets(timestamp), searched.getPackets(timestamp));
+      assert.equal(
+        interpolated.nextTimestamp(timestamp, { type: pingType, subtype: 0 }, 5),
+        searched.nextTimestamp(timestamp, { type: pingType, subtype: 0 }, 5)
+      );
+    }
+
+    const [interpolatedStats] = interpolated.getSearchStats();
+    const [searchedStats] = searched.getSearchStats();
+    assert.is(interpolatedStats.strategy, 'interpolation');
+    assert.is(searchedStats.strategy, 'binary');
+    assert.is(interpolatedStats.searches, searchedStats.searches);
+    assert.ok(interpolatedStats.probes < searchedStats.probes);
+
+    interpolated.close();
+    searched.close();
+  });
+});
+
+test('NbsDecoder with `compactIndex` gives the same results as the normal index', () => {
+  const compact = new NbsDecoder(samplePaths, { compactIndex: true, searchStats: true });
+
+  assert.equal(compact.getAvailableTypes(), decoder.getAvailableTypes());
+  assert.equal(compact.getTimestampRange(), decoder.getTimestampRange());
+
+  for (const type of decoder.getAvailableTypes()) {
+    assert.equal(compact.getTypeIndex(type), decoder.getTypeIndex(type));
+    assert.equal(compact.getTimestampRange(type), decoder.getTimestampRange(type));
+    assert.equal(compact.getPacketByIndex(120, type), decoder.getPacketByIndex(120, type));
+  }
+
+  for (let seconds = 998; seconds <= 1902; seconds += 7) {
+    const timestamp = { seconds, nanos: 500 };
+    assert.equal(compact.getPackets(timestamp), decoder.getPackets(timestamp));
+    assert.equal(
+      compact.nextTimestamp(timestamp, { type: pangType, subtype: 200 }, -2),
+      decoder.nextTimestamp(timestamp, { type: pangType, subtype: 200 }, -2)
+    );
+  }
+
+  const cursor = compact.cursor({ timestamp: { seconds: 1299, nanos: 500000000 } });
+  assert.equal(cursor.next().payload, Buffer.from('ping.300', 'utf8'));
+
+  assert.ok(
+    compact.getSearchStats().every((stats) => stats.strategy === 'compact' && stats.searches > 0)
+  );
+
+  compact.close();
+});
+
+test('NbsDecoder with `zeroCopy` returns the same packets, which outlive the decoder', () => {
+  const zeroCopy = new NbsDecoder(samplePaths, { zeroCopy: true });
+
+  const timestamp = { seconds: 1450, nanos: 0 };
+  const packets = zeroCopy.getPackets(timestamp);
+  assert.equal(packets, decoder.getPackets(timestamp));
+  assert.equal(
+    zeroCopy.getPacketByIndex(10, { type: pingType, subtype: 0 }),
+    decoder.getPacketByIndex(10, { type: pingType, subtype: 0 })
+  );
+
+  // The payloads keep their files mapped after the decoder is closed
+  zeroCopy.close();
+  assert.equal(packets, decoder.getPackets(timestamp));
+});
+
+test('NbsDecoder with access hints returns the same packets, and prefetch() does not change them', () => {
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+
+  for (const options of [
+    { accessPattern: 'sequential', populate: Infinity },
+    { accessPattern: 'random', hugePages: true },
+  ]) {
+    const hinted = new NbsDecoder(samplePaths, options);
+    hinted.prefetch(start, end);
+    hinted.prefetch(start, end, [{ type: pingType, subtype: 0 }]);
+    assert.equal(hinted.getPacketsInRange(start, end), decoder.getPacketsInRange(start, end));
+  }
+
+  assert.throws(
+    () => decoder.prefetch(start),
+    /invalid type for argument `end`/,
+    'NbsDecoder.prefetch() throws for missing `end` argument'
+  );
+});
+
+test('NbsDecoder with `packetCache` returns cached packets, within its budget', () => {
+  const budget = 32 * 1024;
+  const cached = new NbsDecoder(samplePaths, { packetCache: budget });
+  const timestamp = { seconds: 1450, nanos: 0 };
+
+  const first = cached.getPackets(timestamp);
+  assert.equal(first, decoder.getPackets(timestamp));
+  const { hits, misses, packets } = cached.getCacheStats();
+  assert.equal({ hits, misses, packets }, { hits: 0, misses: 4, packets: 4 });
+
+  // Reading the same packets again returns the same objects
+  const second = cached.getPackets(timestamp);
+  assert.ok(second.every((packet, i) => packet === first[i]));
+  assert.is(cached.getCacheStats().hits, 4);
+  assert.is(
+    cached.getPacketByIndex(150, { type: pingType, subtype: 0 }),
+    first.find((packet) => packet.type.equals(pingType))
+  );
+
+  // Reading more packets than fit drops the least recently used ones
+  const all = cached.getPacketsInRange({ seconds: 1000, nanos: 0 }, { seconds: 1899, nanos: 0 });
+  assert.equal(
+    all,
+    decoder.getPacketsInRange({ seconds: 1000, nanos: 0 }, { seconds: 1899, nanos: 0 })
+  );
+  const stats = cached.getCacheStats();
+  assert.ok(stats.bytes <= budget && stats.packets < all.length);
+  assert.is.not(cached.getPackets(timestamp)[0], first[0]);
+
+  // Without a budget nothing is cached
+  assert.equal(decoder.getCacheStats(), { hits: 0, misses: 0, packets: 0, bytes: 0, budget: 0 });
+});
+
+test('NbsDecoder.getSearchStats() reports how each type is searched', () => {
+  const withTrees = new NbsDecoder([path.join(samplesDir, 'sample-000-300.nbs')], {
+    searchTreeThreshold: 0,
+    searchStats: true,
+  });
+
+  const before = withTrees.getSearchStats();
+  assert.equal(
+    before.map(({ type, subtype }) => ({ type, subtype })),
+    withTrees.getAvailableTypes()
+  );
+  assert.ok(
+    before.every((stats) => stats.strategy === 'tree' && stats.searches === 0 && stats.probes === 0)
+  );
+
+  withTrees.getPackets({ seconds: 1100, nanos: 0 });
+  assert.ok(withTrees.getSearchStats().every((stats) => stats.searches === 1 && stats.probes > 0));
+
+  // Searches aren't counted without the `searchStats` option
+  decoder.getPackets({ seconds: 1100, nanos: 0 });
+  assert.ok(decoder.getSearchStats().every((stats) => stats.searches === 0 && stats.probes === 0));
+
+  withTrees.close();
+});
+
+test('NbsDecoder.getPacketsAt() returns the same packets as getPackets() at each timestamp', () => {
+  const types = [
+    { type: pingType, subtype: 0 },
+    { type: 'fakeIndex', subtype: 0 },
+    { type: pangType, subtype: 200 },
+  ];
+  const found = [types[0], types[2]];
+
+  // Out of order, with repeats, and before the first packet
+  const timestamps = [1450e9, 1000e9, 1450.5e9, 990e9, 1899e9, 1300e9, 1000e9, 1450e9];
+  const { packets, indices } = decoder.getPacketsAt(timestamps, types);
+
+  assert.is(indices.length, timestamps.length * types.length);
+  timestamps.forEach((timestamp, i) => {
+    const expected = decoder.getPackets(timestamp, found);
+    const at = (j) => indices[i * types.length + j];
+
+    assert.is(at(1), 0xffffffff, 'types not in the decoder have no packets');
+    [0, 2].forEach((j, k) => {
+      if (expected[k].payload.length === 0) {
+        assert.is(at(j), 0xffffffff, `no packet of type ${j} at ${timestamp}`);
+      } else {
+        assert.equal(packets[at(j)], expected[k], `packet of type ${j} at ${timestamp}`);
+      }
+    });
+  });
+
+  // Each packet is only returned once
+  assert.is(new Set(packets.map((packet) => tsToBigInt(packet.timestamp))).size, packets.length);
+
+  const nanos = BigUint64Array.from(timestamps.map((timestamp) => BigInt(timestamp)));
+  assert.equal(decoder.getPacketsAt(nanos, types), { packets, indices });
+
+  // Type ids of types that aren't in the decoder keep their column too
+  const ids = decoder.resolveTypes(types);
+  assert.is(ids[1], 0xffffffff);
+  assert.equal(decoder.getPacketsAt(timestamps, ids), { packets, indices });
+
+  assert.throws(
+    () => decoder.getPacketsAt(1450e9, types),
+    /invalid type for argument `timestamps`: expected array or BigUint64Array/,
+    'NbsDecoder.getPacketsAt() throws for invalid `timestamps` argument'
+  );
+});
+
+test('NbsDecoder.getPacketsInRange() returns the packets between two timestamps in timestamp order', () => {
+  const packets = decoder.getPacketsInRange(
+    { seconds: 1297, nanos: 0 },
+    { seconds: 1302, nanos: 0 }
+  );
+  assert.equal(
+    packets.map((packet) => packet.payload.toString('utf8')),
+    ['ping.99', 'pong.99', 'pang.99', 'ping.300', 'pong.300', 'pang.300']
+  );
+  assert.equal(
+    packets[3],
+    decoder.getPackets({ seconds: 1300, nanos: 0 }, [{ type: pingType, subtype: 0 }])[0]
+  );
+
+  const pongs = decoder.getPacketsInRange(
+    { seconds: 1000, nanos: 0 },
+    { seconds: 1030, nanos: 0 },
+    [
+      { type: pongType, subtype: 0 },
+      { type: pongType, subtype: 1 },
+    ]
+  );
+  assert.equal(
+    pongs.map((packet) => packet.payload.toString('utf8')),
+    Array.from({ length: 10 }, (_, i) => `pong.${i}`)
+  );
+
+  assert.equal(
+    decoder.getPacketsInRange({ seconds: 1302, nanos: 0 }, { seconds: 1297, nanos: 0 }),
+    []
+  );
+});
+
+test('NbsDecoder.getPacketsInRange() reads a range a page at a time with `limit` and `offset`', () => {
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+  const all = decoder.getPacketsInRange(start, end);
+  assert.is(all.length, 700);
+
+  const pages = [];
+  for (let offset = 0; offset < all.length; offset += 64) {
+    const page = decoder.getPacketsInRange(start, end, undefined, { limit: 64, offset });
+    assert.is(page.length, Math.min(64, all.length - offset));
+    pages.push(...page);
+  }
+  assert.equal(pages, all);
+
+  assert.equal(decoder.getPacketsInRange(start, end, undefined, { offset: 700 }), []);
+  assert.equal(decoder.getPacketsInRange(start, end, undefined, { limit: 0 }), []);
+
+  assert.throws(
+    () => decoder.getPacketsInRange(start, end, undefined, { limit: -1 }),
+    /invalid option `limit`: expected non-negative number/,
+    'NbsDecoder.getPacketsInRange() throws for invalid `limit` option'
+  );
+
+  assert.throws(
+    () => decoder.getPacketsInRange(start),
+    /invalid type for argument `end`/,
+    'NbsDecoder.getPacketsInRange() throws for missing `end` argument'
+  );
+});
+
+test('NbsDecoder.getPacketColumns() returns the same packets as getPacketsInRange() as columns', () => {
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+
+  const check = (columns, packets) => {
+    assert.instance(columns.timestamps, BigUint64Array);
+    assert.instance(columns.typeIds, Uint32Array);
+    assert.instance(columns.payloads, Buffer);
+    assert.is(columns.timestamps.length, packets.length);
+
+    packets.forEach((packet, i) => {
+      const type = columns.types[columns.typeIds[i]];
+      assert.is(columns.timestamps[i], tsToBigInt(packet.timestamp));
+      assert.ok(type.type.equals(packet.type));
+      assert.is(type.subtype, packet.subtype);
+      assert.is(columns.subtypes[i], packet.subtype);
+
+      const payload = columns.payloads.subarray(
+        columns.offsets[i],
+        columns.offsets[i] + columns.lengths[i]
+      );
+      assert.ok(payload.equals(packet.payload));
+    });
+  };
+
+  check(decoder.getPacketColumns(start, end), decoder.getPacketsInRange(start, end));
+
+  const types = [{ type: pangType, subtype: 200 }];
+  const options = { limit: 20, offset: 5 };
+  check(
+    decoder.getPacketColumns(start, end, types, options),
+    decoder.getPacketsInRange(start, end, types, options)
+  );
+
+  const empty = decoder.getPacketColumns(end, start);
+  assert.is(empty.timestamps.length, 0);
+  assert.is(empty.payloads.length, 0);
+
+  assert.throws(
+    () => decoder.getPacketColumns(start),
+    /invalid type for argument `end`/,
+    'NbsDecoder.getPacketColumns() throws for missing `end` argument'
+  );
+});
+
+test('NbsDecoder.open() opens a decoder on the thread pool', async () => {
+  const opened = await NbsDecoder.open(samplePaths);
+
+  assert.ok(opened instanceof NbsDecoder);
+  assert.equal(opened.getAvailableTypes(), decoder.getAvailableTypes());
+  assert.equal(
+    opened.getPackets({ seconds: 1450, nanos: 0 }),
+    decoder.getPackets({ seconds: 1450, nanos: 0 })
+  );
+
+  assert.throws(
+    () => NbsDecoder.open([]),
+    /invalid argument `paths`: expected non-empty array/,
+    'NbsDecoder.open() throws for empty array argument'
+  );
+
+  try {
+    await NbsDecoder.open([path.join(samplesDir, 'missing.nbs')]);
+    assert.unreachable('NbsDecoder.open() rejects for a missing file');
+  } catch (error) {
+    assert.instance(error, Error);
+    assert.not.equal(error.name, 'AbortError');
+  }
+});
+
+test('NbsDecoder.getPacketsAsync() and getPacketsInRangeAsync() return the same packets as the sync methods', async () => {
+  const timestamp = { seconds: 1450, nanos: 0 };
+  const types = [{ type: pingType, subtype: 0 }];
+  assert.equal(await decoder.getPacketsAsync(timestamp), decoder.getPackets(timestamp));
+  assert.equal(
+    await decoder.getPacketsAsync(timestamp, types),
+    decoder.getPackets(timestamp, types)
+  );
+
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+  assert.equal(
+    await decoder.getPacketsInRangeAsync(start, end),
+    decoder.getPacketsInRange(start, end)
+  );
+  assert.equal(
+    await decoder.getPacketsInRangeAsync(start, end, undefined, { limit: 64, offset: 128 }),
+    decoder.getPacketsInRange(start, end, undefined, { limit: 64, offset: 128 })
+  );
+
+  // Reads that were started before closing the decoder still finish
+  const closing = new NbsDecoder([path.join(samplesDir, 'sample-000-300.nbs')], { zeroCopy: true });
+  const reading = closing.getPacketsInRangeAsync(start, end);
+  closing.close();
+  assert.equal(await reading, decoder.getPacketsInRange(start, { seconds: 1299, nanos: 0 }));
+
+  assert.throws(
+    () => decoder.getPacketsInRangeAsync(start),
+    /invalid type for argument `end`/,
+    'NbsDecoder.getPacketsInRangeAsync() throws for missing `end` argument'
+  );
+});
+
+test('NbsDecoder async methods can be aborted with an AbortSignal', async () => {
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+
+  const aborted = new AbortController();
+  aborted.abort();
+
+  const calls = [
+    decoder.getPacketsAsync(start, undefined, { signal: aborted.signal }),
+    decoder.getPacketsInRangeAsync(start, end, undefined, { signal: aborted.signal }),
+    NbsDecoder.open([path.join(samplesDir, 'sample-000-300.nbs')], { signal: aborted.signal }),
+  ];
+  for (const call of calls) {
+    try {
+      await call;
+      assert.unreachable('an aborted call rejects');
+    } catch (error) {
+      assert.is(error.name, 'AbortError');
+    }
+  }
+
+  // Aborting a call that is already running rejects it too
+  const controller = new AbortController();
+  const running = decoder.getPacketsInRangeAsync(start, end, undefined, {
+    signal: controller.signal,
+  });
+  controller.abort();
+  try {
+    await running;
+    assert.unreachable('a call aborted while running rejects');
+  } catch (error) {
+    assert.is(error.name, 'AbortError');
+  }
+
+  // A signal that isn't aborted changes nothing
+  assert.equal(
+    await decoder.getPacketsInRangeAsync(start, end, undefined, {
+      signal: new AbortController().signal,
+    }),
+    decoder.getPacketsInRange(start, end)
+  );
+
+  assert.throws(
+    () => decoder.getPacketsAsync(start, undefined, { signal: true }),
+    /invalid option `signal`: expected AbortSignal/,
+    'NbsDecoder.getPacketsAsync() throws for invalid `signal` option'
+  );
+});
+
+test('NbsDecoder.stream() yields the packets in a range in timestamp order, a batch at a time', async () => {
+  const start = { seconds: 1100, nanos: 0 };
+  const end = { seconds: 1799, nanos: 0 };
+
+  const streamed = [];
+  for await (const packet of decoder.stream({ start, end, batchSize: 64 })) {
+    streamed.push(packet);
+  }
+  assert.equal(streamed, decoder.getPacketsInRange(start, end));
+
+  const types = [{ type: pingType, subtype: 0 }];
+  const pings = [];
+  for await (const packet of decoder.stream({ types, batchSize: 7 })) {
+    pings.push(packet);
+  }
+  assert.is(pings.length, 300);
+  assert.equal(
+    pings,
+    decoder.getPacketsInRange({ seconds: 1000, nanos: 0 }, { seconds: 1899, nanos: 0 }, types)
+  );
+
+  // Stopping early leaves the batch being read ahead to finish on its own
+  let count = 0;
+  for await (const packet of decoder.stream({ batchSize: 10 })) {
+    if (++count === 15) {
+      break;
+    }
+  }
+  assert.is(count, 15);
+
+  assert.throws(
+    () => decoder.stream({ batchSize: 0 }),
+    /invalid option `batchSize`: expected positive integer/,
+    'NbsDecoder.stream() throws for invalid `batchSize` option'
+  );
+});
+
+test('NbsDecoder.share() shares the index with decoders on worker threads', async () => {
+  const { Worker } = require('worker_threads');
+
+  const shared = new NbsDecoder(samplePaths);
+  const handle = shared.share();
+  assert.equal(shared.share(), handle, 'sharing again gives the same handle');
+
+  const fromShared = NbsDecoder.fromShared(handle);
+  assert.equal(fromShared.getAvailableTypes(), decoder.getAvailableTypes());
+  assert.equal(
+    fromShared.getPackets({ seconds: 1450, nanos: 0 }),
+    decoder.getPackets({ seconds: 1450, nanos: 0 })
+  );
+
+  // Each worker reads a disjoint shard of the recording
+  const readShard = (start, end) =>
+    new Promise((resolve, reject) => {
+      const worker = new Worker(
+        `
+        const { parentPort, workerData } = require('worker_threads');
+        const { NbsDecoder } = require(workerData.module);
+        const decoder = NbsDecoder.fromShared(workerData.handle);
+        const packets = decoder.getPacketsInRange(workerData.start, workerData.end);
+        decoder.close();
+        parentPort.postMessage(packets.map((packet) => packet.payload.toString()));
+        `,
+        { eval: true, workerData: { module: path.join(__dirname, '..'), handle, start, end } }
+      );
+      worker.once('message', resolve);
+      worker.once('error', reject);
+    });
+
+  const shards = await Promise.all([
+    readShard({ seconds: 1000, nanos: 0 }, { seconds: 1449, nanos: 0 }),
+    readShard({ seconds: 1450, nanos: 0 }, { seconds: 1899, nanos: 0 }),
+  ]);
+  assert.equal(
+    shards[0].concat(shards[1]),
+    decoder
+      .getPacketsInRange({ seconds: 1000, nanos: 0 }, { seconds: 1899, nanos: 0 })
+      .map((packet) => packet.payload.toString())
+  );
+
+  assert.throws(
+    () => fromShared.follow(() => {}),
+    /follow\(\) is not supported for shared decoders/
+  );
+  assert.throws(() => shared.evict(), /evict\(\) is not supported for shared decoders/);
+  assert.throws(
+    () => NbsDecoder.fromShared({}),
+    /invalid argument `handle`: expected handle from share\(\)/,
+    'NbsDecoder.fromShared() throws for an invalid handle'
+  );
+
+  // The shared files are released once every decoder reading them is closed
+  shared.close();
+  const another = NbsDecoder.fromShared(handle);
+  assert.ok(another instanceof NbsDecoder);
+  another.close();
+  fromShared.close();
+  assert.throws(() => NbsDecoder.fromShared(handle), /the shared decoder has been closed/);
+});
+
+test('NbsDecoder.cursor() steps through the packets of all types in timestamp order', () => {
+  const cursor = decoder.cursor();
+
+  const first = cursor.next();
+  assert.equal(first.timestamp, { seconds: 1000, nanos: 0 });
+  assert.equal(first.payload, Buffer.from('ping.0', 'utf8'));
+
+  let count = 1;
+  let last = first;
+  for (let packet = cursor.next(); packet !== undefined; packet = cursor.next()) {
+    assert.ok(tsToBigInt(packet.timestamp) > tsToBigInt(last.timestamp));
+    last = packet;
+    count++;
+  }
+  assert.is(count, 900);
+  assert.equal(last.payload, Buffer.from('pang.699', 'utf8'));
+
+  assert.equal(cursor.prev(), last);
+  assert.equal(cursor.prev().payload, Buffer.from('pong.699', 'utf8'));
+
+  cursor.seek({ seconds: 1450, nanos: 0 });
+  assert.equal(cursor.next().payload, Buffer.from('ping.350', 'utf8'));
+  assert.equal(cursor.prev().payload, Buffer.from('ping.350', 'utf8'));
+  assert.equal(cursor.prev().payload, Buffer.from('pang.349', 'utf8'));
+
+  cursor.seek({ seconds: 0, nanos: 0 });
+  assert.is(cursor.prev(), undefined);
+  assert.equal(cursor.next(), first);
+});
+
+test('NbsDecoder.cursor() steps through only the given types, from the given timestamp', () => {
+  const cursor = decoder.cursor({
+    types: [{ type: pongType, subtype: 0 }],
+    timestamp: { seconds: 1001, nanos: 1 },
+  });
+
+  assert.equal(cursor.next().payload, Buffer.from('pong.1', 'utf8'));
+  assert.equal(cursor.next().payload, Buffer.from('pong.2', 'utf8'));
+  assert.equal(cursor.prev().payload, Buffer.from('pong.2', 'utf8'));
+  assert.equal(cursor.prev().payload, Buffer.from('pong.1', 'utf8'));
+  assert.equal(cursor.prev().payload, Buffer.from('pong.0', 'utf8'));
+  assert.is(cursor.prev(), undefined);
+
+  // Stepping through several of the types merges them in the same order as getPacketsInRange()
+  const types = [
+    { type: pangType, subtype: 200 },
+    { type: pingType, subtype: 0 },
+  ];
+  const merged = decoder.cursor({ types });
+  const packets = [];
+  for (let packet = merged.next(); packet !== undefined; packet = merged.next()) {
+    packets.push(packet);
+  }
+  const [start, end] = decoder.getTimestampRange();
+  assert.equal(packets, decoder.getPacketsInRange(start, end, types));
+  assert.equal(merged.prev(), packets[packets.length - 1]);
+  assert.equal(merged.prev(), packets[packets.length - 2]);
+
+  const missing = decoder.cursor({ types: [{ type: pongType, subtype: 1 }] });
+  assert.is(missing.next(), undefined);
+
+  // Cursors find nothing once their decoder is closed, rather than reading the types they had
+  const closing = new NbsDecoder([path.join(samplesDir, 'sample-000-300.nbs')]);
+  const some = closing.cursor({ types });
+  const every = closing.cursor();
+  assert.ok(some.next());
+  assert.ok(every.next());
+  closing.close();
+  assert.is(some.next(), undefined);
+  assert.is(some.prev(), undefined);
+  some.seek({ seconds: 1000, nanos: 0 });
+  assert.is(some.next(), undefined);
+  assert.is(every.next(), undefined);
+
+  assert.throws(
+    () => decoder.cursor({ types: {} }),
+    /invalid option `types`: expected array/,
+    'NbsDecoder.cursor() throws for invalid `types` option'
+  );
+
+  assert.throws(
+    () => decoder.cursor().seek('1000'),
+    /invalid type for argument `timestamp`/,
+    'NbsDecoder.cursor().seek() throws for invalid `timestamp` argument'
+  );
+});
+
+test('NbsDecoder.typeCursor() returns the same packets as getPackets() as it moves', () => {
+  const types = [
+    { type: pingType, subtype: 0 },
+    { type: pangType, subtype: 100 },
+    { type: 'fakeIndex', subtype: 0 },
+  ];
+  const cursor = decoder.typeCursor(types);
+
+  // Play forwards a little at a time, then jump around
+  const timestamps = [];
+  for (let seconds = 990; seconds < 1100; seconds += 0.7) {
+    timestamps.push(Math.floor(seconds * 1e9));
+  }
+  timestamps.push(1850e9, 1200e9, 1199e9, 1900e9, 0, 1500e9);
+
+  for (const timestamp of timestamps) {
+    assert.equal(cursor.seek(timestamp), decoder.getPackets(timestamp, types), `at ${timestamp}`);
+  }
+
+  const all = decoder.typeCursor(decoder.resolveTypes(decoder.getAvailableTypes()));
+  assert.equal(all.seek(1450e9), decoder.getPackets(1450e9));
+
+  assert.throws(
+    () => decoder.typeCursor(false),
+    /invalid type for argument `types`: expected array or undefined/,
+    'NbsDecoder.typeCursor() throws for invalid `types` argument'
+  );
+});
+
 test('NbsDecoder.getPacketByIndex() throws for invalid arguments', () => {
   assert.throws(
     () => {